@@ -189,6 +189,21 @@ fn trace_attributes(c: &mut Criterion) {
             let response = actor.trace_attributes(black_box(&request)).unwrap();
             black_box(response)
         });
+
+        c.bench_function("trace match map snap", |b| {
+            let request = proto::Options {
+                costing_type: proto::costing::Type::Auto as i32,
+                shape_match: proto::ShapeMatch::MapSnap as i32,
+                has_encoded_polyline: Some(proto::options::HasEncodedPolyline::EncodedPolyline(
+                    shape.into(),
+                )),
+                ..Default::default()
+            };
+            b.iter(|| {
+                let trace_match = actor.trace_match(black_box(&request)).unwrap();
+                black_box(trace_match)
+            });
+        });
     });
 }
 
@@ -235,6 +250,78 @@ fn locate(c: &mut Criterion) {
             black_box(response)
         });
     });
+
+    c.bench_function("locate act_json", |b| {
+        let request = r#"{
+            "locations":[{
+                "lat":42.50107335756198,
+                "lon":1.510341967860551
+            }],
+            "verbose": true
+        }"#;
+        b.iter(|| {
+            let response = actor
+                .act_json(proto::options::Action::Locate, black_box(request))
+                .unwrap();
+            black_box(response)
+        });
+    });
+}
+
+fn matrix(c: &mut Criterion) {
+    let config = ConfigBuilder {
+        mjolnir: valhalla::config::Mjolnir {
+            tile_extract: ANDORRA_TILES.into(),
+            traffic_extract: ANDORRA_TRAFFIC.into(),
+            ..Default::default()
+        },
+        ..Default::default()
+    }
+    .build();
+    let mut actor = Actor::new(&config).unwrap();
+
+    // 10x10 grid over Andorra la Vella and Escaldes-Engordany
+    let locations: Vec<_> = (0..10)
+        .map(|i| proto::Location {
+            ll: LatLon(42.500 + i as f64 * 0.002, 1.515 + i as f64 * 0.003).into(),
+            ..Default::default()
+        })
+        .collect();
+    let request = proto::Options {
+        costing_type: proto::costing::Type::Auto as i32,
+        sources: locations.clone(),
+        targets: locations,
+        ..Default::default()
+    };
+
+    c.bench_function("matrix json", |b| {
+        let request = proto::Options {
+            format: proto::options::Format::Json as i32,
+            ..request.clone()
+        };
+        b.iter(|| {
+            let response = actor.matrix(black_box(&request)).unwrap();
+            black_box(response)
+        });
+    });
+
+    c.bench_function("matrix concise json", |b| {
+        b.iter(|| {
+            let response = actor.matrix_concise_json(black_box(&request)).unwrap();
+            black_box(response)
+        });
+    });
+
+    c.bench_function("matrix pbf", |b| {
+        let request = proto::Options {
+            format: proto::options::Format::Pbf as i32,
+            ..request.clone()
+        };
+        b.iter(|| {
+            let response = actor.matrix(black_box(&request)).unwrap();
+            black_box(response)
+        });
+    });
 }
 
 fn status(c: &mut Criterion) {
@@ -262,5 +349,5 @@ fn status(c: &mut Criterion) {
     });
 }
 
-criterion_group!(benches, route, trace_attributes, locate, status);
+criterion_group!(benches, route, trace_attributes, locate, matrix, status);
 criterion_main!(benches);
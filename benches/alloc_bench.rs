@@ -0,0 +1,103 @@
+#![cfg(feature = "proto")]
+
+//! Counts Rust heap allocations per request in steady state. Allocations made by Valhalla itself are not visible
+//! here, as C++ uses its own allocator.
+
+use std::alloc::{GlobalAlloc, Layout, System};
+use std::hint::black_box;
+use std::sync::atomic::{AtomicUsize, Ordering};
+
+use valhalla::{Actor, ConfigBuilder, LatLon, proto};
+
+const ANDORRA_TILES: &str = "tests/andorra/tiles.tar";
+
+const ANDORRA_TEST_LOC_1: LatLon = LatLon(42.50107335756198, 1.510341967860551); // Sant Julia de Loria
+const ANDORRA_TEST_LOC_2: LatLon = LatLon(42.50627089323736, 1.521734167223563); // Andorra la Vella
+
+struct CountingAllocator;
+
+static ALLOCATIONS: AtomicUsize = AtomicUsize::new(0);
+
+unsafe impl GlobalAlloc for CountingAllocator {
+    unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+        ALLOCATIONS.fetch_add(1, Ordering::Relaxed);
+        unsafe { System.alloc(layout) }
+    }
+
+    unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+        unsafe { System.dealloc(ptr, layout) }
+    }
+
+    unsafe fn realloc(&self, ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
+        ALLOCATIONS.fetch_add(1, Ordering::Relaxed);
+        unsafe { System.realloc(ptr, layout, new_size) }
+    }
+}
+
+#[global_allocator]
+static ALLOCATOR: CountingAllocator = CountingAllocator;
+
+/// Average number of allocations per call after a warm-up call, which fills reused buffers.
+fn allocations_per_call(iterations: usize, mut f: impl FnMut()) -> f64 {
+    f();
+    let before = ALLOCATIONS.load(Ordering::Relaxed);
+    for _ in 0..iterations {
+        f();
+    }
+    (ALLOCATIONS.load(Ordering::Relaxed) - before) as f64 / iterations as f64
+}
+
+fn main() {
+    let config = ConfigBuilder {
+        mjolnir: valhalla::config::Mjolnir {
+            tile_extract: ANDORRA_TILES.into(),
+            ..Default::default()
+        },
+        ..Default::default()
+    }
+    .build();
+    let mut actor = Actor::new(&config).unwrap();
+
+    let locations = vec![
+        proto::Location {
+            ll: ANDORRA_TEST_LOC_1.into(),
+            ..Default::default()
+        },
+        proto::Location {
+            ll: ANDORRA_TEST_LOC_2.into(),
+            ..Default::default()
+        },
+    ];
+    let locate = proto::Options {
+        format: proto::options::Format::Json as i32,
+        costing_type: proto::costing::Type::Auto as i32,
+        locations: locations.clone(),
+        ..Default::default()
+    };
+    let route = proto::Options {
+        format: proto::options::Format::Json as i32,
+        costing_type: proto::costing::Type::Auto as i32,
+        locations: locations.clone(),
+        ..Default::default()
+    };
+    let matrix = proto::Options {
+        format: proto::options::Format::Json as i32,
+        costing_type: proto::costing::Type::Auto as i32,
+        sources: locations.clone(),
+        targets: locations,
+        ..Default::default()
+    };
+
+    const ITERATIONS: usize = 100;
+    let cases: [(&str, &proto::Options, fn(&mut Actor, &proto::Options) -> _); 3] = [
+        ("locate json", &locate, Actor::locate),
+        ("route json", &route, Actor::route),
+        ("matrix json", &matrix, Actor::matrix),
+    ];
+    for (name, request, call) in cases {
+        let allocations = allocations_per_call(ITERATIONS, || {
+            black_box(call(&mut actor, black_box(request)).unwrap());
+        });
+        println!("{name}: {allocations:.1} Rust allocations per request");
+    }
+}
@@ -1,6 +1,6 @@
 use criterion::{Criterion, criterion_group, criterion_main};
 use std::hint::black_box;
-use valhalla::{ConfigBuilder, GraphId, GraphReader, LiveTraffic};
+use valhalla::{ConfigBuilder, EdgeIndex, GraphId, GraphReader, LatLon, LiveTraffic, polyline};
 
 fn write_traffic(c: &mut Criterion) {
     let config = ConfigBuilder {
@@ -53,5 +53,101 @@ fn write_traffic(c: &mut Criterion) {
     });
 }
 
-criterion_group!(benches, write_traffic);
+fn edge_index(c: &mut Criterion) {
+    let config = ConfigBuilder {
+        mjolnir: valhalla::config::Mjolnir {
+            tile_extract: "./tests/andorra/tiles.tar".to_string(),
+            ..Default::default()
+        },
+        ..Default::default()
+    }
+    .build();
+    let graph_reader = GraphReader::new(&config).unwrap();
+
+    // Grid of points over Andorra la Vella and Escaldes-Engordany
+    let points: Vec<_> = (0..100)
+        .map(|i| {
+            LatLon(
+                42.500 + (i / 10) as f64 * 0.002,
+                1.515 + (i % 10) as f64 * 0.002,
+            )
+        })
+        .collect();
+
+    let mut group = c.benchmark_group("edge index nearest");
+    let index = EdgeIndex::new(&graph_reader).unwrap();
+    group.bench_function("tile shapes", |b| {
+        b.iter(|| {
+            for &point in &points {
+                black_box(index.nearest(point, 50.0, 10));
+            }
+        });
+    });
+    let index =
+        EdgeIndex::with_decoded_shapes(&graph_reader, EdgeIndex::DEFAULT_CELL_SIZE).unwrap();
+    group.bench_function("decoded shapes", |b| {
+        b.iter(|| {
+            for &point in &points {
+                black_box(index.nearest(point, 50.0, 10));
+            }
+        });
+    });
+    group.finish();
+}
+
+fn polyline(c: &mut Criterion) {
+    let config = ConfigBuilder {
+        mjolnir: valhalla::config::Mjolnir {
+            tile_extract: "./tests/andorra/tiles.tar".to_string(),
+            ..Default::default()
+        },
+        ..Default::default()
+    }
+    .build();
+    let graph_reader = GraphReader::new(&config).unwrap();
+
+    // Realistic long shape, like of a route with tens of thousands of points, made of real edge shapes
+    let mut points = Vec::new();
+    for tile_id in graph_reader.tiles() {
+        let tile = graph_reader.graph_tile(tile_id).unwrap();
+        for de in tile.directededges().iter().filter(|de| !de.is_shortcut()) {
+            let shape = tile.edgeinfo(de).shape;
+            polyline::decode_into(&shape, polyline::PRECISION6, &mut points).unwrap();
+        }
+    }
+    points.truncate(50_000);
+    let encoded = polyline::encode(&points, polyline::PRECISION6);
+
+    let mut group = c.benchmark_group("polyline");
+    group.bench_function("encode", |b| {
+        let mut buffer = String::new();
+        b.iter(|| {
+            buffer.clear();
+            polyline::encode_into(black_box(&points), polyline::PRECISION6, &mut buffer);
+            black_box(buffer.len())
+        });
+    });
+    group.bench_function("decode", |b| {
+        let mut buffer = Vec::new();
+        b.iter(|| {
+            buffer.clear();
+            polyline::decode_into(black_box(&encoded), polyline::PRECISION6, &mut buffer).unwrap();
+            black_box(buffer.len())
+        });
+    });
+
+    // Edge shapes are encoded on the C++ side
+    let tile_id = graph_reader.tiles()[0];
+    let tile = graph_reader.graph_tile(tile_id).unwrap();
+    group.bench_function("edgeinfo shapes", |b| {
+        b.iter(|| {
+            for de in tile.directededges() {
+                black_box(tile.edgeinfo(de));
+            }
+        });
+    });
+    group.finish();
+}
+
+criterion_group!(benches, write_traffic, edge_index, polyline);
 criterion_main!(benches);
@@ -18,9 +18,12 @@ fn main() {
     // https://doc.rust-lang.org/beta/rustc/linker-plugin-lto.html
     // Disable LTO for Debug builds to have reasonable compile times.
     let lto = build_type != "Debug" && has_lld();
+    // Profile-guided optimization of C++ code, see `scripts/pgo.sh`
+    let pgo = pgo_flags();
 
     // Build & link required Valhalla libraries
-    let dst = cmake::Config::new("valhalla")
+    let mut valhalla = cmake::Config::new("valhalla");
+    valhalla
         .define("CMAKE_BUILD_TYPE", build_type)
         .define("CMAKE_EXPORT_COMPILE_COMMANDS", "ON") // Required to extract include paths
         .define(
@@ -43,9 +46,12 @@ fn main() {
         .define("CMAKE_UNITY_BUILD_BATCH_SIZE", "11")
         // Rust type system guarantees that `GraphTile` instance will be accessed only from a single thread
         .define("ENABLE_THREAD_SAFE_TILE_REF_COUNT", "OFF")
-        .define("LOGGING_LEVEL", "WARN") // todo: Provide an API for setting custom loggers to Valhalla
-        .build_target("valhalla")
-        .build();
+        // Messages below this level are compiled out, the rest can be routed to Rust with `logging::install()`
+        .define("LOGGING_LEVEL", "WARN");
+    for flag in &pgo {
+        valhalla.cflag(flag).cxxflag(flag);
+    }
+    let dst = valhalla.build_target("valhalla").build();
     // Clean up temporarily created `valhalla/third_party/tz/leapseconds` to keep source tree clean.
     // N.B.: avoid adding `println!("cargo:rerun-if-changed=valhalla");` as this file will always trigger a rebuild.
     let _ = fs::remove_file("valhalla/third_party/tz/leapseconds");
@@ -61,20 +67,36 @@ fn main() {
     );
 
     // Linking order is important, so valhalla-cxxbridge must come first.
-    let rust_sources = ["src/config.rs", "src/lib.rs"]
-        .into_iter()
-        .chain(cfg!(feature = "proto").then_some("src/actor.rs"));
+    let rust_sources = [
+        "src/config.rs",
+        "src/edge_index.rs",
+        "src/graph_tools.rs",
+        "src/lib.rs",
+        "src/logging.rs",
+    ]
+    .into_iter()
+    .chain(cfg!(feature = "proto").then_some("src/actor.rs"));
     cxx_build::bridges(rust_sources)
+        .file("src/edge_index.cpp")
+        .file("src/graph_tools.cpp")
         .file("src/libvalhalla.cpp")
+        .file("src/logging.cpp")
         .std("c++20")
         .includes(valhalla_includes)
         .flags(if lto { vec!["-flto=thin"] } else { vec![] })
+        .flags(&pgo)
         .compile("libvalhalla-cxxbridge");
     println!("cargo:rerun-if-changed=src/actor.hpp");
     println!("cargo:rerun-if-changed=src/config.hpp");
     println!("cargo:rerun-if-changed=src/costing.hpp");
+    println!("cargo:rerun-if-changed=src/edge_index.cpp");
+    println!("cargo:rerun-if-changed=src/edge_index.hpp");
+    println!("cargo:rerun-if-changed=src/graph_tools.cpp");
+    println!("cargo:rerun-if-changed=src/graph_tools.hpp");
     println!("cargo:rerun-if-changed=src/libvalhalla.cpp");
     println!("cargo:rerun-if-changed=src/libvalhalla.hpp");
+    println!("cargo:rerun-if-changed=src/logging.cpp");
+    println!("cargo:rerun-if-changed=src/logging.hpp");
 
     // pkg_config resolves all dependencies based on the libvalhalla.pc file (generated by cmake)
     // and emits the correct cargo link directives.
@@ -166,6 +188,28 @@ fn has_lld() -> bool {
     false
 }
 
+/// Clang flags to instrument C++ code with `VALHALLA_PGO_GENERATE=<dir>`, writing raw profiles into `dir`, or to
+/// optimize it with `VALHALLA_PGO_USE=<file.profdata>`, merged by `llvm-profdata`. Rust code is instrumented and
+/// optimized with the matching `-Cprofile-generate` and `-Cprofile-use` rustc flags, so both halves are profiled by
+/// the same run and share the merged profile.
+fn pgo_flags() -> Vec<String> {
+    println!("cargo:rerun-if-env-changed=VALHALLA_PGO_GENERATE");
+    println!("cargo:rerun-if-env-changed=VALHALLA_PGO_USE");
+    if let Ok(dir) = std::env::var("VALHALLA_PGO_GENERATE") {
+        vec![format!("-fprofile-generate={dir}")]
+    } else if let Ok(profile) = std::env::var("VALHALLA_PGO_USE") {
+        println!("cargo:rerun-if-changed={profile}");
+        vec![
+            format!("-fprofile-use={profile}"),
+            // Most of Valhalla is not covered by the profiling workload, which is expected. Functions changed since
+            // the profile was collected are still reported, as that means the profile should be collected again.
+            "-Wno-profile-instr-unprofiled".into(),
+        ]
+    } else {
+        vec![]
+    }
+}
+
 /// Represents a Python literal value from `valhalla_build_config`.
 /// Mirrors the subset of Python syntax used in the `config` and `help_text` dicts.
 #[derive(Debug, Clone)]
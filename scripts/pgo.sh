@@ -0,0 +1,46 @@
+#!/usr/bin/env bash
+#
+# Builds valhalla-rs with profile-guided optimization (PGO) of both the Valhalla C++ library and the Rust bindings.
+# Profiles are collected by running `actor_bench` and `tiles_bench` on the Andorra fixture with an instrumented
+# build, merged with `llvm-profdata` and used for the final release build.
+#
+# Usage:
+#   ./scripts/pgo.sh [cargo build args...]
+#
+# Prerequisites: clang and llvm-profdata with the same LLVM major version as rustc (see `rustc -vV`), as Rust and
+# C++ profiles are merged into a single file. `rustup component add llvm-tools` provides a matching llvm-profdata.
+#
+# Environment:
+#   PGO_DIR        directory for profiles and the instrumented build, `target/pgo` by default
+#   LLVM_PROFDATA  llvm-profdata binary, `llvm-profdata` by default
+#   BENCH_SECONDS  seconds to run each benchmark for, 5 by default
+
+set -euo pipefail
+
+PGO_DIR="$(realpath -m "${PGO_DIR:-target/pgo}")"
+LLVM_PROFDATA="${LLVM_PROFDATA:-llvm-profdata}"
+BENCH_SECONDS="${BENCH_SECONDS:-5}"
+PROFILE="$PGO_DIR/merged.profdata"
+
+export CC=clang CXX=clang++
+
+rm -rf "$PGO_DIR/profiles"
+mkdir -p "$PGO_DIR/profiles"
+
+echo "Collecting profiles into $PGO_DIR/profiles"
+# The instrumented build has its own target dir to not invalidate the regular one. Debug info of both builds is
+# disabled, as it switches Valhalla to the `RelWithDebInfo` CMake build type with different optimization flags, and
+# a profile collected with one build type doesn't match the code of another.
+CARGO_TARGET_DIR="$PGO_DIR/target" \
+    CARGO_PROFILE_BENCH_DEBUG=false \
+    RUSTFLAGS="${RUSTFLAGS:-} -Cprofile-generate=$PGO_DIR/profiles" \
+    VALHALLA_PGO_GENERATE="$PGO_DIR/profiles" \
+    cargo bench --bench actor_bench --bench tiles_bench -- --profile-time "$BENCH_SECONDS"
+
+"$LLVM_PROFDATA" merge -o "$PROFILE" "$PGO_DIR/profiles"
+
+echo "Building with $PROFILE"
+CARGO_PROFILE_RELEASE_DEBUG=false \
+    RUSTFLAGS="${RUSTFLAGS:-} -Cprofile-use=$PROFILE" \
+    VALHALLA_PGO_USE="$PROFILE" \
+    cargo build --release "$@"
@@ -1,149 +1,800 @@
 #pragma once
 
+#include <valhalla/baldr/traffictile.h>
 #include <valhalla/loki/worker.h>
+#include <valhalla/meili/map_matcher_factory.h>
 #include <valhalla/odin/worker.h>
+#include <valhalla/proto_conversions.h>
+#include <valhalla/thor/matrixalgorithm.h>
 #include <valhalla/thor/worker.h>
 #include <valhalla/tyr/serializers.h>
 
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string_view>
+
 // This struct is generated by `cxx` based on shared definition in `valhalla/src/actor.rs.h`.
 struct Response;
 
 // This strange FD *before* this include is requred to have an ability to use generated Rust types in C++ code.
 struct Actor;
+struct ActorStats;
+struct MatrixProfile;
+struct TraceSession;
 #include "valhalla/src/actor.rs.h"
 
+/// Graph reader and map matcher factory shared by all trace sessions of an actor, so thousands of live sessions share
+/// a single tile cache and candidate cache. Neither cache is thread-safe while sessions may live on any thread, so
+/// every use of the context happens under its mutex.
+struct TraceContext {
+  std::shared_ptr<valhalla::baldr::GraphReader> reader;
+  valhalla::meili::MapMatcherFactory matcher_factory;
+  std::mutex mutex;
+
+  explicit TraceContext(const boost::property_tree::ptree& config)
+      : reader(std::make_shared<valhalla::baldr::GraphReader>(config.get_child("mjolnir"))),
+        matcher_factory(config, reader) {}
+};
+
+/// Incremental map matching of a live trace. Instead of re-matching the whole trace each time a new point arrives,
+/// only a bounded window of recent points is matched: `lookahead` newest points are kept unfinalized, as the next
+/// points may still change their match, and `lookahead` already finalized points are kept as a context for the HMM.
+/// This makes the cost of each `push()` independent of the trace length.
+struct TraceSession final {
+  struct TracePoint {
+    valhalla::midgard::PointLL ll;
+    double time;
+  };
+
+  std::shared_ptr<TraceContext> context;
+  /// Created on the first match, as `valhalla::ParseApi` requires a trace to set up the costing options.
+  std::unique_ptr<valhalla::meili::MapMatcher> matcher;
+  valhalla::Options options;
+  /// GPS accuracy and search radius of the request, set by `valhalla::ParseApi` along with the matcher.
+  float gps_accuracy = 0.0f;
+  float search_radius = 0.0f;
+  size_t lookahead;
+
+  std::deque<TracePoint> window;
+  /// Trace index of the `window.front()`.
+  uint32_t window_begin = 0;
+  /// Trace index of the first point that is not finalized yet.
+  uint32_t finalized_end = 0;
+
+  TraceSession(std::shared_ptr<TraceContext> context, valhalla::Options options, uint32_t lookahead)
+      : context(std::move(context)), options(std::move(options)), lookahead(std::max<uint32_t>(lookahead, 1)) {}
+
+  ~TraceSession() {
+    // The matcher holds tiles of the shared reader
+    std::lock_guard lock(context->mutex);
+    matcher.reset();
+  }
+
+  rust::Vec<MatchedPoint> push(double lat, double lon, double time) {
+    window.push_back(TracePoint{ .ll = valhalla::midgard::PointLL(lon, lat), .time = time });
+    if (window_begin + window.size() - finalized_end <= lookahead) {
+      return {};
+    }
+
+    auto matched = finalize(window_begin + window.size() - lookahead);
+    // Keep only `lookahead` finalized points as a context for the next match
+    while (finalized_end - window_begin > lookahead) {
+      window.pop_front();
+      ++window_begin;
+    }
+    return matched;
+  }
+
+  rust::Vec<MatchedPoint> finish() { return finalize(window_begin + window.size()); }
+
+private:
+  /// Matches the current window and returns match results for points in `[finalized_end, end)` range.
+  rust::Vec<MatchedPoint> finalize(uint32_t end) {
+    rust::Vec<MatchedPoint> matched;
+    if (end <= finalized_end) {
+      return matched;
+    }
+
+    std::lock_guard lock(context->mutex);
+    if (!matcher) {
+      valhalla::Api api;
+      *api.mutable_options() = options;
+      for (const auto& point : window) {
+        auto* ll = api.mutable_options()->add_shape()->mutable_ll();
+        ll->set_lat(point.ll.lat());
+        ll->set_lng(point.ll.lng());
+      }
+      // Sets per-point accuracy and radius from the request, the same for all points without their own values
+      valhalla::ParseApi("", valhalla::Options::trace_attributes, api);
+      gps_accuracy = api.options().shape(0).accuracy();
+      search_radius = api.options().shape(0).radius();
+      matcher.reset(context->matcher_factory.Create(api.options()));
+    }
+
+    std::vector<valhalla::meili::Measurement> measurements;
+    measurements.reserve(window.size());
+    for (const auto& point : window) {
+      measurements.emplace_back(point.ll, gps_accuracy, search_radius, point.time);
+    }
+    matcher->Clear();
+    const auto results = matcher->OfflineMatch(measurements);
+    if (results.empty()) {
+      throw std::runtime_error("Failed to match the trace");
+    }
+
+    matched.reserve(end - finalized_end);
+    for (uint32_t i = finalized_end; i < end; ++i) {
+      const auto& result = results.front().results[i - window_begin];
+      matched.push_back(MatchedPoint{
+        .point_index = i,
+        .edge = result.HasState() ? result.edgeid : valhalla::baldr::GraphId(),
+        .percent_along = result.distance_along,
+        .distance = result.distance_from,
+      });
+    }
+    finalized_end = end;
+    return matched;
+  }
+};
+
+/// Parses Valhalla's local `YYYY-MM-DDTHH:MM` date time. Time zones don't matter for the arithmetic, so the result is
+/// treated as if it was in UTC.
+inline std::chrono::sys_seconds parse_date_time(const std::string& date_time) {
+  int year, month, day, hour, minute;
+  if (std::sscanf(date_time.c_str(), "%d-%d-%dT%d:%d", &year, &month, &day, &hour, &minute) != 5) {
+    throw std::runtime_error("Invalid date time " + date_time);
+  }
+  const std::chrono::year_month_day date{ std::chrono::year(year), std::chrono::month(month), std::chrono::day(day) };
+  if (!date.ok()) {
+    throw std::runtime_error("Invalid date time " + date_time);
+  }
+  return std::chrono::sys_days(date) + std::chrono::hours(hour) + std::chrono::minutes(minute);
+}
+
+/// Inverse of [`parse_date_time()`].
+inline std::string format_date_time(std::chrono::sys_seconds time) {
+  const auto days = std::chrono::floor<std::chrono::days>(time);
+  const std::chrono::year_month_day date(days);
+  const std::chrono::hh_mm_ss hms(time - days);
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "%04d-%02u-%02uT%02d:%02d", static_cast<int>(date.year()),
+                static_cast<unsigned>(date.month()), static_cast<unsigned>(date.day()),
+                static_cast<int>(hms.hours().count()), static_cast<int>(hms.minutes().count()));
+  return buffer;
+}
+
+/// Whether the connection between a source and a target was found. Both matrix algorithms set the time of connections
+/// that are not found to the `kMaxCost` sentinel, which Valhalla's serializer writes as `null`.
+inline bool connection_found(const valhalla::Matrix& matrix, int i) {
+  return matrix.times(i) != valhalla::thor::kMaxCost;
+}
+
+/// Makes `thor_worker.matrix` serialize only the computed matrix as PBF, which is the cheapest possible output, when
+/// the response is built from the [`valhalla::Api`] object directly.
+inline void select_matrix_pbf(valhalla::Options& options) {
+  options.set_format(valhalla::Options::pbf);
+  options.clear_pbf_field_selector();
+  options.mutable_pbf_field_selector()->set_matrix(true);
+}
+
+/// Appends a non-negative number truncated to 3 decimals, without trailing zeros, like `rapidjson` does with
+/// `SetMaxDecimalPlaces(3)`: the shortest representation of the value is cut, not rounded.
+inline void append_decimal(std::string& out, double value) {
+  char buffer[352];
+  const auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::fixed);
+  const char* dot = std::find(buffer, end, '.');
+  if (dot == end) {
+    out.append(buffer, end);
+    return;
+  }
+  const char* last = std::min(end, dot + 4);
+  while (last[-1] == '0') {
+    --last;
+  }
+  if (last[-1] == '.') {
+    --last;
+  }
+  out.append(buffer, last);
+}
+
+inline void append_integer(std::string& out, uint64_t value) {
+  char buffer[24];
+  const auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+  out.append(buffer, end);
+}
+
+/// Appends a quoted JSON string, escaping quotes, backslashes and control characters.
+inline void append_string(std::string& out, std::string_view value) {
+  out += '"';
+  for (const char c : value) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char buffer[8];
+      std::snprintf(buffer, sizeof(buffer), "\\u%04x", static_cast<unsigned>(c));
+      out += buffer;
+    } else {
+      out += c;
+    }
+  }
+  out += '"';
+}
+
+/// Writes the computed matrix in the concise Valhalla JSON format of `verbose: false` requests:
+/// `{"id":"...","sources_to_targets":{"durations":[[...]],"distances":[[...]]},"units":"...","algorithm":"...",
+/// "warnings":[...]}` with the same values as Valhalla's serializer: durations truncated to whole seconds, distances
+/// truncated to 3 decimals and `null` for connections that are not found. The `id` and `warnings` are written only
+/// when present. Values are appended straight into a preallocated buffer with `std::to_chars`, without building a
+/// DOM or going through `rapidjson` writers. Appends to `out`, so a recycled buffer keeps its capacity.
+inline void write_concise_matrix_json(const valhalla::Api& api, std::string& out) {
+  const auto& options = api.options();
+  const auto& matrix = api.matrix();
+  const bool miles = options.units() == valhalla::Options::miles;
+  const double meters_to_units = miles ? 0.000621371192 : 0.001;
+  const int sources = options.sources_size();
+  const int targets = options.targets_size();
+  const int pairs = std::min(sources * targets, matrix.times_size());
+
+  // Up to 6 digits for durations and 7 characters for distances with separators per pair is enough in most cases
+  out.reserve(out.size() + 64 + static_cast<size_t>(sources) * targets * 16);
+  const auto write_rows = [&](const char* name, const auto& write_value) {
+    out += '"';
+    out += name;
+    out += "\":[";
+    for (int s = 0; s < sources; ++s) {
+      out += s == 0 ? "[" : ",[";
+      for (int t = 0; t < targets; ++t) {
+        if (t != 0) {
+          out += ',';
+        }
+        const int i = s * targets + t;
+        if (i < pairs && connection_found(matrix, i)) {
+          write_value(i);
+        } else {
+          out += "null";
+        }
+      }
+      out += ']';
+    }
+    out += ']';
+  };
+
+  out += '{';
+  if (options.has_id_case()) {
+    out += "\"id\":";
+    append_string(out, options.id());
+    out += ',';
+  }
+  out += "\"sources_to_targets\":{";
+  write_rows("durations", [&](int i) { append_integer(out, static_cast<uint64_t>(matrix.times(i))); });
+  out += ',';
+  write_rows("distances", [&](int i) { append_decimal(out, matrix.distances(i) * meters_to_units); });
+  out += "},\"units\":\"";
+  out += miles ? "miles" : "kilometers";
+  out += "\",\"algorithm\":";
+  append_string(out, valhalla::MatrixAlgoToString(matrix.algorithm()));
+  if (api.info().warnings_size() > 0) {
+    out += ",\"warnings\":[";
+    for (int w = 0; w < api.info().warnings_size(); ++w) {
+      const auto& warning = api.info().warnings(w);
+      out += w == 0 ? "{\"code\":" : ",{\"code\":";
+      append_integer(out, warning.code());
+      out += ",\"text\":";
+      append_string(out, warning.description());
+      out += '}';
+    }
+    out += ']';
+  }
+  out += '}';
+}
+
+/// Resident memory of the process in bytes, read from `/proc/self/statm`. Zero where it's not available.
+inline uint64_t resident_memory() {
+  uint64_t pages = 0;
+  uint64_t resident = 0;
+  if (FILE* statm = std::fopen("/proc/self/statm", "r")) {
+    if (std::fscanf(statm, "%" SCNu64 " %" SCNu64, &pages, &resident) != 2) {
+      resident = 0;
+    }
+    std::fclose(statm);
+  }
+  return resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+}
+
+/// Ages of the live traffic tiles of the reader, read from the memory mapped traffic tile headers.
+inline TrafficAges traffic_ages(const valhalla::baldr::GraphReader& reader) {
+  // Hack to expose protected `baldr::GraphReader::tile_extract_`, as `new_tileset()` does for the extract type
+  struct ExtractReader : valhalla::baldr::GraphReader {
+    static const auto& extract(const valhalla::baldr::GraphReader& reader) {
+      return reader.*&ExtractReader::tile_extract_;
+    }
+  };
+
+  TrafficAges ages{};
+  const auto& extract = ExtractReader::extract(reader);
+  if (!extract) {
+    return ages;
+  }
+  const auto now = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+  uint64_t oldest = now;
+  uint64_t newest = 0;
+  for (const auto& [id, memory] : extract->traffic_tiles) {
+    if (memory.second < sizeof(valhalla::baldr::TrafficTileHeader)) {
+      continue;
+    }
+    const auto* header = reinterpret_cast<const volatile valhalla::baldr::TrafficTileHeader*>(memory.first);
+    ages.tiles += 1;
+    const uint64_t last_update = header->last_update;
+    if (last_update != 0) {
+      ages.updated_tiles += 1;
+      oldest = std::min(oldest, last_update);
+      newest = std::max(newest, last_update);
+    }
+  }
+  if (ages.updated_tiles != 0) {
+    // Clocks of the updater and of this process may differ slightly, so updates from the future are just fresh
+    ages.min_age_secs = now - std::min(newest, now);
+    ages.max_age_secs = now - std::min(oldest, now);
+  }
+  return ages;
+}
+
+/// Live counters of requests of one action. Each actor keeps its own counters and is used by one thread at a time,
+/// so updating them is just a few additions without any synchronization.
+struct ActionCounters {
+  /// Weight of the latest request in `recent_ms`, which makes it an average of roughly the last 20 requests.
+  static constexpr double kRecentWeight = 0.05;
+
+  uint64_t requests = 0;
+  uint64_t errors = 0;
+  double total_ms = 0.0;
+  double recent_ms = 0.0;
+  double max_ms = 0.0;
+
+  void record(double ms, bool failed) {
+    recent_ms = requests == 0 ? ms : recent_ms + kRecentWeight * (ms - recent_ms);
+    requests += 1;
+    errors += failed ? 1 : 0;
+    total_ms += ms;
+    max_ms = std::max(max_ms, ms);
+  }
+};
+
+/// Endpoints of the actor that run an action in their own way. They are counted in separate buckets after the ones
+/// of the actions, as their latencies aren't comparable with the regular requests of the action.
+struct OwnEndpoint {
+  ActorEndpoint endpoint;
+  valhalla::Options::Action action;
+  const char* name;
+};
+constexpr std::array<OwnEndpoint, 2> kOwnEndpoints = { {
+  { ActorEndpoint::TraceMatch, valhalla::Options::trace_attributes, "trace_match" },
+  { ActorEndpoint::MatrixProfile, valhalla::Options::sources_to_targets, "matrix_profile" },
+} };
+
 /// Copy&paste of the `valhalla::tyr::actor_t` class, but without the parsing json request format.
 struct Actor final {
+  boost::property_tree::ptree config;
   std::shared_ptr<valhalla::baldr::GraphReader> reader;
 
   valhalla::loki::loki_worker_t loki_worker;
   valhalla::thor::thor_worker_t thor_worker;
   valhalla::odin::odin_worker_t odin_worker;
+  std::unique_ptr<valhalla::meili::MapMatcherFactory> matcher_factory;
+  /// Request of `act()` and `act_json()`, reused between calls: `Clear()` keeps the allocated strings and repeated
+  /// fields, so parsing a request of a similar shape doesn't allocate again.
+  valhalla::Api reused_api;
+  /// Response buffer handed back by Rust with `recycle()` once the response is copied out, reused by the next
+  /// `matrix_concise_json()` response, the only one the actor writes itself.
+  std::unique_ptr<std::string> spare_output;
+  /// Counters of the regular requests per action, followed by the counters of `kOwnEndpoints`.
+  std::array<ActionCounters, valhalla::Options::Action_ARRAYSIZE + kOwnEndpoints.size()> counters;
+  /// Shared by all trace sessions of the actor and created with the first one.
+  mutable std::shared_ptr<TraceContext> trace_context;
+  mutable std::once_flag trace_context_once;
 
   Actor() : reader{}, loki_worker({}, reader), thor_worker({}, reader), odin_worker({}) {}
 
   Actor(const boost::property_tree::ptree& config)
-      : reader(std::make_shared<valhalla::baldr::GraphReader>(config.get_child("mjolnir"))),
+      : config(config),
+        reader(std::make_shared<valhalla::baldr::GraphReader>(config.get_child("mjolnir"))),
         loki_worker(config, reader),
         thor_worker(config, reader),
-        odin_worker(config) {
+        odin_worker(config),
+        matcher_factory(std::make_unique<valhalla::meili::MapMatcherFactory>(config, reader)) {
     if (reader->GetTileSet().empty()) {
       throw std::runtime_error("Failed to load tileset");
     }
   }
 
-  Response route(rust::Slice<const uint8_t> request) {
-    return act(request, valhalla::Options::route, [this](valhalla::Api& api) {
-      loki_worker.route(api);
-      thor_worker.route(api);
-      return odin_worker.narrate(api);
-    });
+  Response route(rust::Slice<const uint8_t> request) { return act(request, valhalla::Options::route); }
+  Response locate(rust::Slice<const uint8_t> request) { return act(request, valhalla::Options::locate); }
+  Response matrix(rust::Slice<const uint8_t> request) { return act(request, valhalla::Options::sources_to_targets); }
+  Response optimized_route(rust::Slice<const uint8_t> request) {
+    return act(request, valhalla::Options::optimized_route);
+  }
+  Response isochrone(rust::Slice<const uint8_t> request) { return act(request, valhalla::Options::isochrone); }
+  Response trace_route(rust::Slice<const uint8_t> request) { return act(request, valhalla::Options::trace_route); }
+  Response trace_attributes(rust::Slice<const uint8_t> request) {
+    return act(request, valhalla::Options::trace_attributes);
+  }
+  Response transit_available(rust::Slice<const uint8_t> request) {
+    return act(request, valhalla::Options::transit_available);
   }
+  Response expansion(rust::Slice<const uint8_t> request) { return act(request, valhalla::Options::expansion); }
+  Response centroid(rust::Slice<const uint8_t> request) { return act(request, valhalla::Options::centroid); }
+  Response status(rust::Slice<const uint8_t> request) { return act(request, valhalla::Options::status); }
 
-  Response locate(rust::Slice<const uint8_t> request) {
-    return act(request, valhalla::Options::locate, [this](valhalla::Api& api) { return loki_worker.locate(api); });
+  /// Executes a Valhalla JSON request, parsing it with `valhalla::ParseApi` exactly once, like `tyr::actor_t` does.
+  Response act_json(rust::Str json, int32_t action) {
+    RequestTimer timer(*this, static_cast<valhalla::Options::Action>(action));
+    reused_api.Clear();
+    valhalla::ParseApi(static_cast<std::string>(json), static_cast<valhalla::Options::Action>(action), reused_api);
+    return execute(reused_api, static_cast<valhalla::Options::Action>(action));
   }
 
-  Response matrix(rust::Slice<const uint8_t> request) {
-    return act(request, valhalla::Options::sources_to_targets, [this](valhalla::Api& api) {
-      loki_worker.matrix(api);
-      return thor_worker.matrix(api);
-    });
+  /// Computes the matrix like `matrix` does, but always writes the concise JSON with [`write_concise_matrix_json()`]
+  /// instead of the `tyr` serializer.
+  Response matrix_concise_json(rust::Slice<const uint8_t> request) {
+    RequestTimer timer(*this, valhalla::Options::sources_to_targets);
+    reused_api.Clear();
+    auto* api = &reused_api;
+    if (!api->mutable_options()->ParseFromArray(request.data(), request.size())) {
+      throw std::runtime_error("Failed to parse API request");
+    }
+    valhalla::ParseApi("", valhalla::Options::sources_to_targets, *api);
+
+    CleanupGuard guard(*this);
+    loki_worker.matrix(*api);
+    select_matrix_pbf(*api->mutable_options());
+    thor_worker.matrix(*api);
+    auto output = take_output();
+    write_concise_matrix_json(*api, *output);
+    return Response{
+      .data = std::move(output),
+      .format = valhalla::Options::json,
+    };
   }
 
-  Response optimized_route(rust::Slice<const uint8_t> request) {
-    return act(request, valhalla::Options::optimized_route, [this](valhalla::Api& api) {
-      loki_worker.matrix(api);
-      thor_worker.optimized_route(api);
-      return odin_worker.narrate(api);
-    });
+  /// Computes the matrix for `buckets` departure times, `interval_minutes` apart, starting at the request date time.
+  /// Locations are correlated once and reused for all departures, and only the time-dependent expansion is repeated.
+  /// Departure times are local, so buckets are evenly spaced on the local clock even across DST changes.
+  MatrixProfile matrix_profile(rust::Slice<const uint8_t> request, uint32_t buckets, uint32_t interval_minutes) {
+    // Travel times of the whole profile are kept in memory, 256 MiB at most
+    constexpr uint64_t kMaxProfileTimes = static_cast<uint64_t>(1) << 26;
+    if (buckets == 0) {
+      throw std::runtime_error("Matrix profile requires at least one bucket");
+    }
+
+    RequestTimer timer(*this, ActorEndpoint::MatrixProfile);
+    reused_api.Clear();
+    auto* api = &reused_api;
+    if (!api->mutable_options()->ParseFromArray(request.data(), request.size())) {
+      throw std::runtime_error("Failed to parse API request");
+    }
+    valhalla::ParseApi("", valhalla::Options::sources_to_targets, *api);
+    if (api->options().date_time_type() != valhalla::Options::depart_at) {
+      throw std::runtime_error("Matrix profile requires a departure date time");
+    }
+    const auto pairs_count = static_cast<uint64_t>(api->options().sources_size()) * api->options().targets_size();
+    if (pairs_count * buckets > kMaxProfileTimes) {
+      throw std::runtime_error("Matrix profile is too large, reduce the number of locations or buckets");
+    }
+    const auto start = parse_date_time(api->options().date_time());
+
+    CleanupGuard guard(*this);
+    loki_worker.matrix(*api);
+    select_matrix_pbf(*api->mutable_options());
+    const valhalla::Options correlated = api->options();
+
+    const uint32_t pairs = correlated.sources_size() * correlated.targets_size();
+    std::vector<float> times(static_cast<size_t>(pairs) * buckets, std::numeric_limits<float>::infinity());
+    for (uint32_t b = 0; b < buckets; ++b) {
+      *api->mutable_options() = correlated;
+      api->clear_matrix();
+      const auto date_time = format_date_time(start + std::chrono::minutes(static_cast<int64_t>(b) * interval_minutes));
+      api->mutable_options()->set_date_time(date_time);
+      for (auto& source : *api->mutable_options()->mutable_sources()) {
+        source.set_date_time(date_time);
+      }
+
+      thor_worker.matrix(*api);
+      thor_worker.cleanup();
+      const auto& bucket_times = api->matrix().times();
+      for (int i = 0; i < std::min<int>(bucket_times.size(), pairs); ++i) {
+        if (connection_found(api->matrix(), i)) {
+          times[static_cast<size_t>(i) * buckets + b] = bucket_times[i];
+        }
+      }
+    }
+
+    MatrixProfile profile{
+      .sources = static_cast<uint32_t>(correlated.sources_size()),
+      .targets = static_cast<uint32_t>(correlated.targets_size()),
+      .buckets = buckets,
+    };
+    profile.times.reserve(times.size());
+    for (const auto time : times) {
+      profile.times.push_back(time);
+    }
+    return profile;
   }
 
-  Response isochrone(rust::Slice<const uint8_t> request) {
-    return act(request, valhalla::Options::isochrone, [this](valhalla::Api& api) {
-      loki_worker.isochrones(api);
-      return thor_worker.isochrones(api);
-    });
+  /// Map-matches the trace like `trace_attributes` does, but returns only the matched points and the sequence of
+  /// matched edges, skipping all edge attributes and the serialization of the response.
+  TraceMatch trace_match(rust::Slice<const uint8_t> request) {
+    if (!matcher_factory) {
+      throw std::runtime_error("Actor is not initialized");
+    }
+
+    RequestTimer timer(*this, ActorEndpoint::TraceMatch);
+    reused_api.Clear();
+    auto* api = &reused_api;
+    if (!api->mutable_options()->ParseFromArray(request.data(), request.size())) {
+      throw std::runtime_error("Failed to parse API request");
+    }
+    // Decodes the trace and sets per-point defaults, such as search radius and gps accuracy
+    valhalla::ParseApi("", valhalla::Options::trace_attributes, *api);
+    // Points are always map-matched, while walking the edges of an exact shape would need a whole thor pass
+    if (api->options().shape_match() == valhalla::ShapeMatch::edge_walk) {
+      throw std::runtime_error("trace_match doesn't support edge_walk shape match");
+    }
+
+    std::vector<valhalla::meili::Measurement> measurements;
+    measurements.reserve(api->options().shape_size());
+    for (const auto& location : api->options().shape()) {
+      measurements.emplace_back(valhalla::midgard::PointLL(location.ll().lng(), location.ll().lat()),
+                                location.accuracy(), location.radius(), location.time());
+    }
+
+    MatcherCacheGuard cache_guard(*matcher_factory);
+    std::unique_ptr<valhalla::meili::MapMatcher> matcher(matcher_factory->Create(api->options()));
+    const auto results = matcher->OfflineMatch(measurements);
+    if (results.empty()) {
+      throw std::runtime_error("Failed to match the trace");
+    }
+
+    TraceMatch trace_match;
+    trace_match.points.reserve(results.front().results.size());
+    for (uint32_t i = 0; i < results.front().results.size(); ++i) {
+      const auto& result = results.front().results[i];
+      trace_match.points.push_back(MatchedPoint{
+        .point_index = i,
+        .edge = result.HasState() ? result.edgeid : valhalla::baldr::GraphId(),
+        .percent_along = result.distance_along,
+        .distance = result.distance_from,
+      });
+    }
+    for (const auto& segment : results.front().segments) {
+      // Consecutive segments may belong to the same edge if there are several points on it
+      if (segment.edgeid.Is_Valid() && (trace_match.edges.empty() || trace_match.edges.back() != segment.edgeid)) {
+        trace_match.edges.push_back(segment.edgeid);
+      }
+    }
+    return trace_match;
   }
 
-  Response trace_route(rust::Slice<const uint8_t> request) {
-    return act(request, valhalla::Options::trace_route, [this](valhalla::Api& api) {
-      loki_worker.trace(api);
-      thor_worker.trace_route(api);
-      return odin_worker.narrate(api);
-    });
+  /// Snapshot of the counters of all actions with at least one request, along with the resident memory.
+  ActorStats stats() const {
+    ActorStats stats;
+    for (size_t bucket = 0; bucket < counters.size(); ++bucket) {
+      const auto& action_counters = counters[bucket];
+      if (action_counters.requests != 0) {
+        const bool own = bucket >= valhalla::Options::Action_ARRAYSIZE;
+        const auto* endpoint = own ? &kOwnEndpoints[bucket - valhalla::Options::Action_ARRAYSIZE] : nullptr;
+        stats.actions.push_back(ActionStats{
+          .endpoint = own ? endpoint->endpoint : ActorEndpoint::Action,
+          .action = static_cast<int32_t>(own ? endpoint->action : bucket),
+          .requests = action_counters.requests,
+          .errors = action_counters.errors,
+          .total_latency_ms = action_counters.total_ms,
+          .recent_latency_ms = action_counters.recent_ms,
+          .max_latency_ms = action_counters.max_ms,
+        });
+      }
+    }
+    stats.resident_memory = resident_memory();
+    stats.traffic = traffic_ages(*reader);
+    return stats;
   }
 
-  Response trace_attributes(rust::Slice<const uint8_t> request) {
-    return act(request, valhalla::Options::trace_attributes, [this](valhalla::Api& api) {
-      loki_worker.trace(api);
-      return thor_worker.trace_attributes(api);
-    });
+  /// Takes back the buffer of a consumed response, keeping its capacity for the next response.
+  void recycle(std::unique_ptr<std::string> output) {
+    output->clear();
+    spare_output = std::move(output);
   }
 
-  Response transit_available(rust::Slice<const uint8_t> request) {
-    return act(request, valhalla::Options::transit_available,
-               [this](valhalla::Api& api) { return loki_worker.transit_available(api); });
+  /// Starts a new incremental map matching session for the costing and trace options in the `request`.
+  std::unique_ptr<TraceSession> trace_session(rust::Slice<const uint8_t> request, uint32_t lookahead) const {
+    valhalla::Options options;
+    if (!options.ParseFromArray(request.data(), request.size())) {
+      throw std::runtime_error("Failed to parse API request");
+    }
+    std::call_once(trace_context_once, [&] { trace_context = std::make_shared<TraceContext>(config); });
+    return std::make_unique<TraceSession>(trace_context, std::move(options), lookahead);
   }
 
-  Response expansion(rust::Slice<const uint8_t> request) {
-    return act(request, valhalla::Options::expansion, [this](valhalla::Api& api) {
+private:
+  /// It's important to call `cleanup` after each action call to ensure that next
+  /// action does not accidentally start where the previous one left off.
+  struct CleanupGuard {
+    Actor& actor_;
+    explicit CleanupGuard(Actor& actor) : actor_(actor) {}
+    ~CleanupGuard() {
+      actor_.loki_worker.cleanup();
+      actor_.thor_worker.cleanup();
+      actor_.odin_worker.cleanup();
+    }
+  };
+
+  /// Clears the candidate cache of the matcher factory after map matching, even if matching throws, so the cache
+  /// doesn't grow unbounded with requests in different areas.
+  struct MatcherCacheGuard {
+    valhalla::meili::MapMatcherFactory& factory_;
+    explicit MatcherCacheGuard(valhalla::meili::MapMatcherFactory& factory) : factory_(factory) {}
+    ~MatcherCacheGuard() { factory_.ClearCache(); }
+  };
+
+  /// Records the latency of a request into the counters of its action, as an error if the request throws.
+  struct RequestTimer {
+    ActionCounters& counters_;
+    const int exceptions_ = std::uncaught_exceptions();
+    const std::chrono::steady_clock::time_point start_ = std::chrono::steady_clock::now();
+    RequestTimer(Actor& actor, valhalla::Options::Action action) : counters_(actor.counters_of(action)) {}
+    RequestTimer(Actor& actor, ActorEndpoint endpoint) : counters_(actor.counters_of(endpoint)) {}
+    ~RequestTimer() {
+      const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start_;
+      counters_.record(elapsed.count(), std::uncaught_exceptions() > exceptions_);
+    }
+  };
+
+  ActionCounters& counters_of(valhalla::Options::Action action) {
+    if (action < 0 || action >= static_cast<int>(counters.size())) {
+      throw std::runtime_error("Unsupported action " + std::to_string(action));
+    }
+    return counters[action];
+  }
+
+  ActionCounters& counters_of(ActorEndpoint endpoint) {
+    for (size_t i = 0; i < kOwnEndpoints.size(); ++i) {
+      if (kOwnEndpoints[i].endpoint == endpoint) {
+        return counters[valhalla::Options::Action_ARRAYSIZE + i];
+      }
+    }
+    throw std::runtime_error("Unsupported endpoint");
+  }
+
+  /// Appends the live counters to the JSON object of the `status` response, as
+  /// `"counters":{"actions":{"route":{"requests":...},...},"resident_memory":...,"traffic":{"tiles":...}}`.
+  void append_counters_json(std::string& out) const {
+    if (out.empty() || out.back() != '}') {
+      return;
+    }
+    out.pop_back();
+    if (!out.empty() && out.back() != '{') {
+      out += ',';
+    }
+    out += "\"counters\":{\"actions\":{";
+    bool first = true;
+    for (size_t bucket = 0; bucket < counters.size(); ++bucket) {
+      const auto& action_counters = counters[bucket];
+      if (action_counters.requests == 0) {
+        continue;
+      }
+      out += first ? "\"" : ",\"";
+      first = false;
+      if (bucket < valhalla::Options::Action_ARRAYSIZE) {
+        out += valhalla::Options::Action_Name(static_cast<valhalla::Options::Action>(bucket));
+      } else {
+        out += kOwnEndpoints[bucket - valhalla::Options::Action_ARRAYSIZE].name;
+      }
+      out += "\":{\"requests\":";
+      append_integer(out, action_counters.requests);
+      out += ",\"errors\":";
+      append_integer(out, action_counters.errors);
+      out += ",\"mean_latency_ms\":";
+      append_decimal(out, action_counters.total_ms / action_counters.requests);
+      out += ",\"recent_latency_ms\":";
+      append_decimal(out, action_counters.recent_ms);
+      out += ",\"max_latency_ms\":";
+      append_decimal(out, action_counters.max_ms);
+      out += '}';
+    }
+    out += "},\"resident_memory\":";
+    append_integer(out, resident_memory());
+    const auto traffic = traffic_ages(*reader);
+    out += ",\"traffic\":{\"tiles\":";
+    append_integer(out, traffic.tiles);
+    out += ",\"updated_tiles\":";
+    append_integer(out, traffic.updated_tiles);
+    out += ",\"min_age_secs\":";
+    append_integer(out, traffic.min_age_secs);
+    out += ",\"max_age_secs\":";
+    append_integer(out, traffic.max_age_secs);
+    out += "}}}";
+  }
+
+  /// Recycled response buffer, or a new one if the previous response wasn't handed back.
+  std::unique_ptr<std::string> take_output() {
+    return spare_output ? std::move(spare_output) : std::make_unique<std::string>();
+  }
+
+  /// Runs the workers of the action on the already parsed request and returns the serialized response.
+  std::string dispatch(valhalla::Api& api, valhalla::Options::Action action) {
+    switch (action) {
+    case valhalla::Options::route:
+      loki_worker.route(api);
+      thor_worker.route(api);
+      return odin_worker.narrate(api);
+    case valhalla::Options::locate: return loki_worker.locate(api);
+    case valhalla::Options::sources_to_targets: loki_worker.matrix(api); return thor_worker.matrix(api);
+    case valhalla::Options::optimized_route:
+      loki_worker.matrix(api);
+      thor_worker.optimized_route(api);
+      return odin_worker.narrate(api);
+    case valhalla::Options::isochrone: loki_worker.isochrones(api); return thor_worker.isochrones(api);
+    case valhalla::Options::trace_route:
+      loki_worker.trace(api);
+      thor_worker.trace_route(api);
+      return odin_worker.narrate(api);
+    case valhalla::Options::trace_attributes: loki_worker.trace(api); return thor_worker.trace_attributes(api);
+    case valhalla::Options::transit_available: return loki_worker.transit_available(api);
+    case valhalla::Options::expansion:
       switch (api.options().expansion_action()) {
       case valhalla::Options::route: loki_worker.route(api); break;
       case valhalla::Options::isochrone: loki_worker.isochrones(api); break;
       default: loki_worker.matrix(api); break;
       }
       return thor_worker.expansion(api);
-    });
-  }
-
-  Response centroid(rust::Slice<const uint8_t> request) {
-    return act(request, valhalla::Options::centroid, [this](valhalla::Api& api) {
+    case valhalla::Options::centroid:
       loki_worker.route(api);
       thor_worker.centroid(api);
       return odin_worker.narrate(api);
-    });
-  }
-
-  Response status(rust::Slice<const uint8_t> request) {
-    return act(request, valhalla::Options::status, [this](valhalla::Api& api) {
+    case valhalla::Options::status:
       loki_worker.status(api);
       thor_worker.status(api);
       odin_worker.status(api);
       return valhalla::tyr::serializeStatus(api);
-    });
+    default: throw std::runtime_error("Unsupported action " + std::to_string(action));
+    }
   }
 
-private:
-  /// `request` is a serialized [`valhalla::Options`] protobuf object.
-  template <typename Fn>
-  Response act(rust::Slice<const uint8_t> request, valhalla::Options::Action action, Fn&& action_fn) {
-    google::protobuf::Arena arena;
-    auto* api = google::protobuf::Arena::Create<valhalla::Api>(&arena);
-    if (!api->mutable_options()->ParseFromArray(request.data(), request.size())) {
+  /// `options` is a serialized [`valhalla::Options`] protobuf object.
+  Response act(rust::Slice<const uint8_t> options, valhalla::Options::Action action) {
+    RequestTimer timer(*this, action);
+    reused_api.Clear();
+    if (!reused_api.mutable_options()->ParseFromArray(options.data(), options.size())) {
       throw std::runtime_error("Failed to parse API request");
     }
 
     // This function sets many defaults in the API object and validates the request.
-    valhalla::ParseApi("", action, *api);
-    const auto format = api->options().format();
-
-    /// It's important to call `cleanup` after each action call to ensure that next
-    /// action does not accidentally start where the previous one left off.
-    struct CleanupGuard {
-      Actor& actor_;
-      explicit CleanupGuard(Actor& actor) : actor_(actor) {}
-      ~CleanupGuard() {
-        actor_.loki_worker.cleanup();
-        actor_.thor_worker.cleanup();
-        actor_.odin_worker.cleanup();
-      }
-    } guard(*this);
+    valhalla::ParseApi("", action, reused_api);
+    return execute(reused_api, action);
+  }
 
-    std::string output = action_fn(*api);
+  /// `api` is a request, already parsed and validated by `valhalla::ParseApi`.
+  Response execute(valhalla::Api& api, valhalla::Options::Action action) {
+    const auto format = api.options().format();
+    CleanupGuard guard(*this);
+    // Valhalla serializers return their own strings, so the spare buffer is left for the writers that append into it
+    auto output = std::make_unique<std::string>(dispatch(api, action));
+    if (action == valhalla::Options::status && format == valhalla::Options::json) {
+      append_counters_json(*output);
+    }
 
     return Response{
-      .data = std::make_unique<std::string>(std::move(output)),
+      .data = std::move(output),
       .format = format,
     };
   }
@@ -153,6 +804,34 @@ std::unique_ptr<Actor> new_actor(const boost::property_tree::ptree& config) {
   return std::make_unique<Actor>(config);
 }
 
+/// Serializes an already computed route [`valhalla::Api`] (e.g. stitched from independently computed legs)
+/// into the format requested in its options, exactly as `odin_worker.narrate` does at the end of a route request.
+Response serialize_directions(rust::Slice<const uint8_t> api_data) {
+  valhalla::Api api;
+  if (!api.ParseFromArray(api_data.data(), api_data.size())) {
+    throw std::runtime_error("Failed to parse API object");
+  }
+  const auto format = api.options().format();
+  return Response{
+    .data = std::make_unique<std::string>(valhalla::tyr::serializeDirections(api)),
+    .format = format,
+  };
+}
+
+/// Serializes an already computed matrix [`valhalla::Api`] (e.g. merged from row blocks computed by different workers)
+/// into the format requested in its options, exactly as `thor_worker.matrix` does at the end of a matrix request.
+Response serialize_matrix(rust::Slice<const uint8_t> api_data) {
+  valhalla::Api api;
+  if (!api.ParseFromArray(api_data.data(), api_data.size())) {
+    throw std::runtime_error("Failed to parse API object");
+  }
+  const auto format = api.options().format();
+  return Response{
+    .data = std::make_unique<std::string>(valhalla::tyr::serializeMatrix(api)),
+    .format = format,
+  };
+}
+
 std::unique_ptr<std::string> parse_json_request(rust::Str json, int action) {
   valhalla::Api api;
   valhalla::ParseApi(static_cast<std::string>(json), static_cast<valhalla::Options::Action>(action), api);
@@ -1,10 +1,14 @@
 use prost::Message;
 
-use crate::{Config, Error, proto, proto::options::Format};
+use crate::{Config, Error, LatLon, proto, proto::options::Format};
+
+pub use ffi::{
+    ActionStats, ActorEndpoint, ActorStats, MatchedPoint, MatrixProfile, TraceMatch, TrafficAges,
+};
 
 #[allow(clippy::needless_lifetimes)] // clippy goes nuts with cxx
 #[cxx::bridge]
-mod ffi {
+pub(crate) mod ffi {
     /// Helper struct to provide an access to C++'s buffer with serialized response data.
     struct Response {
         /// Raw response data, either a JSON string or binary data.
@@ -13,18 +17,108 @@ mod ffi {
         format: i32,
     }
 
+    /// Map matching result for a single point of the trace.
+    #[derive(Clone, Copy, Debug)]
+    struct MatchedPoint {
+        /// Index of the point in the trace.
+        point_index: u32,
+        /// Edge the point is matched to. [`GraphId::default()`] if the point can't be matched.
+        edge: GraphId,
+        /// Position of the matched point along the edge, from 0.0 (start) to 1.0 (end).
+        percent_along: f32,
+        /// Distance in meters from the point to its matched position on the edge.
+        distance: f32,
+    }
+
+    /// Compact map matching result of the whole trace.
+    #[derive(Clone, Debug)]
+    struct TraceMatch {
+        /// Match of each point of the trace, in the trace order.
+        points: Vec<MatchedPoint>,
+        /// Sequence of edges the trace is matched to, without consecutive duplicates.
+        edges: Vec<GraphId>,
+    }
+
+    /// Travel times for a range of departure times, computed by [`Actor::matrix_profile()`].
+    #[derive(Clone, Debug)]
+    struct MatrixProfile {
+        sources: u32,
+        targets: u32,
+        buckets: u32,
+        /// Travel times in seconds, in sources by targets by buckets order. Connections that are not
+        /// found are [`f32::INFINITY`].
+        times: Vec<f32>,
+    }
+
+    /// Entry point of the requests counted by an [`ActionStats`].
+    #[derive(Clone, Copy, Debug, PartialEq, Eq, Hash)]
+    enum ActorEndpoint {
+        /// Regular request of the action, e.g. [`Actor::route()`] or [`Actor::act_json()`].
+        Action,
+        /// [`Actor::trace_match()`], which map-matches like [`proto::options::Action::TraceAttributes`].
+        TraceMatch,
+        /// [`Actor::matrix_profile()`], which runs [`proto::options::Action::SourcesToTargets`] per bucket.
+        MatrixProfile,
+    }
+
+    /// Live counters of requests of a single action, see [`Actor::stats()`].
+    #[derive(Clone, Copy, Debug)]
+    struct ActionStats {
+        /// Endpoint of the requests. Endpoints other than [`ActorEndpoint::Action`] are counted separately from the
+        /// regular requests of their action, as their latencies aren't comparable.
+        endpoint: ActorEndpoint,
+        /// [`proto::options::Action`] of the requests, see [`ActionStats::action()`].
+        action: i32,
+        requests: u64,
+        /// Number of requests that failed with an error.
+        errors: u64,
+        /// Cumulative latency of all requests in milliseconds.
+        total_latency_ms: f64,
+        /// Exponential moving average of the latency in milliseconds over roughly the last 20 requests.
+        recent_latency_ms: f64,
+        max_latency_ms: f64,
+    }
+
+    /// Live performance counters of an [`Actor`], returned by [`Actor::stats()`].
+    #[derive(Clone, Debug)]
+    struct ActorStats {
+        /// Counters of actions with at least one request.
+        actions: Vec<ActionStats>,
+        /// Resident memory of the whole process in bytes, or 0 if it's not available on the platform.
+        resident_memory: u64,
+        /// Ages of the live traffic tiles.
+        traffic: TrafficAges,
+    }
+
+    /// Ages of the live traffic tiles, read from their memory mapped headers, see [`Actor::stats()`].
+    #[derive(Clone, Copy, Debug, Default)]
+    struct TrafficAges {
+        /// Number of tiles in the traffic extract.
+        tiles: u64,
+        /// Number of tiles updated at least once, i.e. with a non-zero `last_update`.
+        updated_tiles: u64,
+        /// Seconds since the most recent update of any tile, 0 if no tile was updated.
+        min_age_secs: u64,
+        /// Seconds since the last update of the most outdated updated tile, 0 if no tile was updated.
+        max_age_secs: u64,
+    }
+
     unsafe extern "C++" {
         include!("valhalla/src/actor.hpp");
 
         #[namespace = "boost::property_tree"]
         type ptree = crate::config::ffi::ptree;
 
+        #[namespace = "valhalla::baldr"]
+        type GraphId = crate::GraphId;
+
         type Actor;
         fn new_actor(config: &ptree) -> Result<UniquePtr<Actor>>;
         // All methods accept [`proto::Options`] object serialized as a byte slice.
         fn route(self: Pin<&mut Actor>, request: &[u8]) -> Result<Response>;
         fn locate(self: Pin<&mut Actor>, request: &[u8]) -> Result<Response>;
         fn matrix(self: Pin<&mut Actor>, request: &[u8]) -> Result<Response>;
+        fn matrix_concise_json(self: Pin<&mut Actor>, request: &[u8]) -> Result<Response>;
         fn optimized_route(self: Pin<&mut Actor>, request: &[u8]) -> Result<Response>;
         fn isochrone(self: Pin<&mut Actor>, request: &[u8]) -> Result<Response>;
         fn trace_route(self: Pin<&mut Actor>, request: &[u8]) -> Result<Response>;
@@ -33,6 +127,37 @@ mod ffi {
         fn expansion(self: Pin<&mut Actor>, request: &[u8]) -> Result<Response>;
         fn centroid(self: Pin<&mut Actor>, request: &[u8]) -> Result<Response>;
         fn status(self: Pin<&mut Actor>, request: &[u8]) -> Result<Response>;
+        /// Accepts a Valhalla JSON request instead of a serialized [`proto::Options`] object.
+        fn act_json(self: Pin<&mut Actor>, json: &str, action: i32) -> Result<Response>;
+        fn stats(self: &Actor) -> ActorStats;
+        /// Hands the buffer of a consumed `matrix_concise_json` response back to be reused by the next one.
+        fn recycle(self: Pin<&mut Actor>, output: UniquePtr<CxxString>);
+        fn trace_match(self: Pin<&mut Actor>, request: &[u8]) -> Result<TraceMatch>;
+        fn matrix_profile(
+            self: Pin<&mut Actor>,
+            request: &[u8],
+            buckets: u32,
+            interval_minutes: u32,
+        ) -> Result<MatrixProfile>;
+        fn trace_session(
+            self: &Actor,
+            request: &[u8],
+            lookahead: u32,
+        ) -> Result<UniquePtr<TraceSession>>;
+
+        type TraceSession;
+        fn push(
+            self: Pin<&mut TraceSession>,
+            lat: f64,
+            lon: f64,
+            time: f64,
+        ) -> Result<Vec<MatchedPoint>>;
+        fn finish(self: Pin<&mut TraceSession>) -> Result<Vec<MatchedPoint>>;
+
+        /// Serializes [`proto::Api`] object with computed route into the format requested in its options.
+        fn serialize_directions(api: &[u8]) -> Result<Response>;
+        /// Serializes [`proto::Api`] object with computed matrix into the format requested in its options.
+        fn serialize_matrix(api: &[u8]) -> Result<Response>;
 
         /// Returns [`proto::Options`] object serialized as C++ `std::string` from a Valhalla JSON string.
         fn parse_json_request(json: &str, action: i32) -> Result<UniquePtr<CxxString>>;
@@ -45,6 +170,11 @@ mod ffi {
 unsafe impl Send for ffi::Actor {}
 unsafe impl Sync for ffi::Actor {}
 
+// Safety: `ffi::TraceSession` owns its matcher and accesses the reader shared with other sessions only under
+// the shared mutex, and all its methods require a mutable reference to `self`.
+unsafe impl Send for ffi::TraceSession {}
+unsafe impl Sync for ffi::TraceSession {}
+
 /// Valhalla natively supports multiple response formats, such as JSON, OSRM-like JSON, PBF, and others.
 /// This format is specified on per-request basis using [`proto::Options`] `format` field, selecting one of the
 /// [`proto::options::Format`] options.
@@ -83,6 +213,12 @@ pub enum Response {
 
 impl From<ffi::Response> for Response {
     fn from(response: ffi::Response) -> Self {
+        Self::from(&response)
+    }
+}
+
+impl From<&ffi::Response> for Response {
+    fn from(response: &ffi::Response) -> Self {
         if response.format == Format::Pbf as i32 {
             let api = proto::Api::decode(response.data.as_bytes())
                 .expect("Proper PBF data is guaranteed by Valhalla");
@@ -98,7 +234,15 @@ impl From<ffi::Response> for Response {
 /// High-level interface to interact with [Valhalla's API](https://valhalla.github.io/valhalla/api/).
 /// On contrary to the Valhalla REST and C++ APIs, this interface is designed to be used with [`proto::Options`] only,
 /// to avoid unnecessary conversions and to provide a strongly typed interface.
-pub struct Actor(cxx::UniquePtr<ffi::Actor>);
+///
+/// Requests are encoded into a buffer owned by the actor and reused between calls, and the C++ side parses them into
+/// a reused [`proto::Api`] object, so passing a request doesn't allocate once buffers are warmed up.
+///
+/// Responses are not recycled in general: Valhalla serializers return a new string for every response, which is then
+/// copied into the returned [`Response`]. The only exception is [`Actor::matrix_concise_json()`], which the actor
+/// writes itself into a buffer that is handed back to the C++ side once copied out, so the next matrix is written into
+/// the already allocated capacity.
+pub struct Actor(cxx::UniquePtr<ffi::Actor>, Vec<u8>);
 
 impl Actor {
     /// ```
@@ -114,7 +258,7 @@ impl Actor {
     /// let actor = valhalla::Actor::new(&config);
     /// ```
     pub fn new(config: &Config) -> Result<Self, Error> {
-        Ok(Self(ffi::new_actor(config.inner())?))
+        Ok(Self(ffi::new_actor(config.inner())?, Vec::new()))
     }
 
     /// Calculates a route between locations.
@@ -150,6 +294,119 @@ impl Actor {
         self.act(ffi::Actor::route, request)
     }
 
+    /// Calculates a multi-leg route, computing independent legs concurrently on the given actors.
+    ///
+    /// Legs between [`proto::location::Type::KBreak`] locations don't depend on each other once locations
+    /// are fixed, so each leg is routed as a separate request, spread over `actors` and computed in parallel.
+    /// Computed legs are then stitched into a single route and serialized in the requested format, giving the
+    /// same response as [`Actor::route()`] would give for the whole request.
+    ///
+    /// Falls back to a regular [`Actor::route()`] call on the first actor if legs are not independent, i.e.
+    /// when there are through/via locations or time-dependent routing is requested, as the departure time of
+    /// each leg depends on the arrival time of the previous one.
+    ///
+    /// Actors should be created from the same [`Config`], so all of them share the same memory-mapped tiles.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # fn call_route_parallel(actors: &mut [valhalla::Actor], stops: &[valhalla::LatLon]) {
+    /// use valhalla::proto;
+    ///
+    /// let request = proto::Options {
+    ///     costing_type: proto::costing::Type::Auto as i32,
+    ///     locations: stops
+    ///         .iter()
+    ///         .map(|&ll| proto::Location {
+    ///             ll: ll.into(),
+    ///             ..Default::default()
+    ///         })
+    ///         .collect(),
+    ///     ..Default::default()
+    /// };
+    /// let response = valhalla::Actor::route_parallel(actors, &request);
+    /// # }
+    /// ```
+    pub fn route_parallel(
+        actors: &mut [Actor],
+        request: &proto::Options,
+    ) -> Result<Response, Error> {
+        if actors.is_empty() {
+            return Err(Error("At least one actor is required".into()));
+        }
+
+        let locations = &request.locations;
+        let independent_legs = locations.len() > 2
+            && request.date_time_type == proto::options::DateTimeType::NoTime as i32
+            && locations[1..locations.len() - 1].iter().all(|location| {
+                location.r#type == proto::location::Type::KBreak as i32
+                    || location.r#type == proto::location::Type::KBreakThrough as i32
+            });
+        if actors.len() < 2 || !independent_legs {
+            return actors[0].route(request);
+        }
+
+        // Each leg is requested as PBF with everything needed to stitch and serialize the final route
+        let leg_requests: Vec<_> = locations
+            .windows(2)
+            .map(|pair| proto::Options {
+                format: Format::Pbf as i32,
+                pbf_field_selector: Some(proto::PbfFieldSelector {
+                    options: true,
+                    trip: true,
+                    directions: true,
+                    ..Default::default()
+                }),
+                locations: pair.to_vec(),
+                ..request.clone()
+            })
+            .collect();
+
+        // Actor `i` computes legs `i`, `i + actors.len()`, ... to keep the load balanced
+        let stride = actors.len();
+        let mut legs: Vec<Option<Result<proto::Api, Error>>> = std::iter::repeat_with(|| None)
+            .take(leg_requests.len())
+            .collect();
+        std::thread::scope(|s| {
+            let handles: Vec<_> = actors
+                .iter_mut()
+                .enumerate()
+                .map(|(offset, actor)| {
+                    let leg_requests = &leg_requests;
+                    s.spawn(move || {
+                        (offset..leg_requests.len())
+                            .step_by(stride)
+                            .map(|i| (i, actor.route(&leg_requests[i])))
+                            .collect::<Vec<_>>()
+                    })
+                })
+                .collect();
+            for handle in handles {
+                let results = handle.join().expect("Route leg computation panicked");
+                for (i, result) in results {
+                    legs[i] = Some(result.and_then(|response| match response {
+                        Response::Pbf(api) => Ok(*api),
+                        _ => Err(Error("Expected PBF response for a route leg".into())),
+                    }));
+                }
+            }
+        });
+
+        let mut legs = legs.into_iter().flatten();
+        let mut api = legs.next().expect("At least two legs are computed")?;
+        for leg in legs {
+            append_leg(&mut api, leg?);
+        }
+        // Legs are requested with their own field selector, so the caller's one is restored for the serializer
+        let options = api.options.get_or_insert_default();
+        options.format = request.format;
+        options.pbf_field_selector = request.pbf_field_selector.clone();
+
+        Ok(Response::from(ffi::serialize_directions(
+            &api.encode_to_vec(),
+        )?))
+    }
+
     /// Finds the nearest roads and intersections to input coordinates. Always returns a Valhalla JSON response.
     ///
     /// # Examples
@@ -209,6 +466,69 @@ impl Actor {
         self.act(ffi::Actor::matrix, request)
     }
 
+    /// Computes a time-distance matrix like [`Actor::matrix()`] and returns it as a concise Valhalla JSON, the same
+    /// as for `verbose: false` requests, regardless of the requested format:
+    ///
+    /// ```json
+    /// {"sources_to_targets":{"durations":[[0,312]],"distances":[[0,2.51]]},"units":"kilometers",
+    ///  "algorithm":"costmatrix"}
+    /// ```
+    ///
+    /// Values are the same as Valhalla's serializer writes: durations are truncated to whole seconds, distances are
+    /// in the requested units truncated to 3 decimals and connections that are not found are `null`. The request
+    /// `id` and `warnings` are included when present. The JSON is written straight into a preallocated buffer, which
+    /// is several times faster than the generic serializer for large matrices, where serialization can take longer
+    /// than the computation itself.
+    pub fn matrix_concise_json(&mut self, request: &proto::Options) -> Result<Response, Error> {
+        let Self(actor, buffer) = self;
+        let request = encode_into(request, buffer);
+        let response = actor.as_mut().unwrap().matrix_concise_json(request)?;
+        Ok(recycle(actor.as_mut().unwrap(), response))
+    }
+
+    /// Computes the matrix for `buckets` departure times, `interval_minutes` apart, starting at the request
+    /// `date_time`, which must be set with [`proto::options::DateTimeType::DepartAt`]. E.g. 96 buckets of 15
+    /// minutes give the travel time as a function of the departure time over a whole day.
+    ///
+    /// Unlike calling [`Actor::matrix()`] per departure time, locations are correlated once and reused, so only
+    /// the time-dependent expansions are repeated. Thor still serializes each bucket, but only the bare matrix as
+    /// PBF, which is the cheapest output, and it never crosses into Rust.
+    ///
+    /// Departure times are local to the origins, as the request `date_time` is. Buckets are `interval_minutes`
+    /// apart on the local clock, so across a daylight saving time change two neighbouring buckets are an hour
+    /// more or less apart in absolute time.
+    ///
+    /// Fails if `buckets` is zero or the profile would hold more than 2^26 travel times (256 MiB).
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # fn call_matrix_profile(mut actor: valhalla::Actor, request: valhalla::proto::Options) {
+    /// use valhalla::proto;
+    ///
+    /// let request = proto::Options {
+    ///     date_time_type: proto::options::DateTimeType::DepartAt as i32,
+    ///     has_date_time: Some(proto::options::HasDateTime::DateTime("2025-06-02T00:00".into())),
+    ///     ..request
+    /// };
+    /// let profile = actor.matrix_profile(&request, 96, 15).unwrap();
+    /// let over_the_day = profile.profile(0, 0);
+    /// # }
+    /// ```
+    pub fn matrix_profile(
+        &mut self,
+        request: &proto::Options,
+        buckets: u32,
+        interval_minutes: u32,
+    ) -> Result<MatrixProfile, Error> {
+        let Self(actor, buffer) = self;
+        let request = encode_into(request, buffer);
+        Ok(actor
+            .as_mut()
+            .unwrap()
+            .matrix_profile(request, buckets, interval_minutes)?)
+    }
+
     /// Solves the traveling salesman problem for multiple locations.
     ///
     /// # Examples
@@ -317,6 +637,80 @@ impl Actor {
         self.act(ffi::Actor::trace_attributes, request)
     }
 
+    /// Map-matches a GPS trace like [`Actor::trace_attributes()`] does, but returns only matched points and
+    /// the sequence of matched edges. Skipping edge attributes and response serialization makes it considerably
+    /// faster for bulk map matching, where edge ids are all that is needed.
+    ///
+    /// Points are always map-matched, so `shape_match` set to `edge_walk` is rejected with an error, and
+    /// `walk_or_snap` behaves as `map_snap`.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # fn call_trace_match(mut actor: valhalla::Actor) {
+    /// use valhalla::proto;
+    ///
+    /// let request = proto::Options {
+    ///     costing_type: proto::costing::Type::Auto as i32,
+    ///     has_encoded_polyline: Some(proto::options::HasEncodedPolyline::EncodedPolyline(
+    ///         "_grbgAh~{nhF?lBAzBFvBHxBEtBKdB".into(),
+    ///     )),
+    ///     ..Default::default()
+    /// };
+    /// let trace_match = actor.trace_match(&request).unwrap();
+    /// for point in &trace_match.points {
+    ///     println!("{} -> {} at {}", point.point_index, point.edge, point.percent_along);
+    /// }
+    /// # }
+    /// ```
+    pub fn trace_match(&mut self, request: &proto::Options) -> Result<TraceMatch, Error> {
+        let Self(actor, buffer) = self;
+        let request = encode_into(request, buffer);
+        Ok(actor.as_mut().unwrap().trace_match(request)?)
+    }
+
+    /// Starts an incremental map matching session for a live trace, e.g. for vehicle tracking, where points
+    /// arrive one by one and re-matching the whole trace with [`Actor::trace_attributes()`] on each new point
+    /// is too expensive. Costing and trace options (`costing_type`, `costings`, etc.) are taken from the `request`.
+    ///
+    /// Each new point is matched together with a bounded window of previous points, so the cost of
+    /// [`TraceSession::push()`] doesn't depend on the trace length. `lookahead` is the number of the most recent
+    /// points whose match is not finalized yet, as upcoming points may change it. Larger values give results
+    /// closer to matching the whole trace at once at the cost of latency.
+    ///
+    /// All sessions of the actor share a single tile cache, separate from the actor's one and guarded by a mutex, so
+    /// sessions can be moved to other threads and can outlive the actor. GPS accuracy and search radius are taken from
+    /// `request` the same way as in [`Actor::trace_match()`].
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # fn call_trace_session(actor: &valhalla::Actor, gps: impl Iterator<Item = (valhalla::LatLon, f64)>) {
+    /// use valhalla::proto;
+    ///
+    /// let request = proto::Options {
+    ///     costing_type: proto::costing::Type::Auto as i32,
+    ///     ..Default::default()
+    /// };
+    /// let mut session = actor.trace_session(&request, 5).unwrap();
+    /// for (point, time) in gps {
+    ///     for matched in session.push(point, time).unwrap() {
+    ///         println!("point {} is matched to {}", matched.point_index, matched.edge);
+    ///     }
+    /// }
+    /// let rest = session.finish().unwrap();
+    /// # }
+    /// ```
+    pub fn trace_session(
+        &self,
+        request: &proto::Options,
+        lookahead: u32,
+    ) -> Result<TraceSession, Error> {
+        let buffer = request.encode_to_vec();
+        let session = self.0.as_ref().unwrap().trace_session(&buffer, lookahead)?;
+        Ok(TraceSession(session))
+    }
+
     /// Checks if transit/public transportation is available at given locations.
     ///
     /// # Examples
@@ -422,6 +816,29 @@ impl Actor {
         self.act(ffi::Actor::status, request)
     }
 
+    /// Returns live counters of the requests executed by this actor: number of requests and errors, cumulative,
+    /// recent and maximal latencies per action, as well as the resident memory of the process and the ages of
+    /// the live traffic tiles. Counters are kept per actor, so they are updated without any synchronization, and
+    /// the JSON response of [`Actor::status()`] includes them as `counters` too.
+    ///
+    /// [`Actor::trace_match()`] and [`Actor::matrix_profile()`] are counted under their own [`ActorEndpoint`]s,
+    /// while [`Actor::matrix_concise_json()`] is counted as a regular matrix request, as it's the same computation.
+    /// Traffic tile ages are read from the headers of all traffic tiles on each call. Tile cache hit ratios are
+    /// not available, as Valhalla's tile cache doesn't count hits.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # fn print_stats(actor: &valhalla::Actor) {
+    /// for action in actor.stats().actions {
+    ///     println!("{:?}: {:.1} ms", action.action(), action.recent_latency_ms);
+    /// }
+    /// # }
+    /// ```
+    pub fn stats(&self) -> ActorStats {
+        self.0.as_ref().unwrap().stats()
+    }
+
     /// Generic helper function to process request encoding, calling the endpoint and handling response.
     fn act<F>(&mut self, action_fn: F, request: &proto::Options) -> Result<Response, Error>
     where
@@ -430,14 +847,46 @@ impl Actor {
             &'a [u8],
         ) -> Result<ffi::Response, cxx::Exception>,
     {
-        let buffer = request.encode_to_vec();
-        let result = action_fn(self.0.as_mut().unwrap(), &buffer);
-        Ok(Response::from(result?))
+        let Self(actor, buffer) = self;
+        let request = encode_into(request, buffer);
+        let response = action_fn(actor.as_mut().unwrap(), request)?;
+        Ok(Response::from(response))
+    }
+
+    /// Executes a Valhalla JSON request for the given action, e.g. as received by an HTTP server, and returns
+    /// the response in the format requested in the JSON.
+    ///
+    /// The request is parsed once on the C++ side and executed right away, which is much cheaper than
+    /// [`Actor::parse_json_request()`] followed by an endpoint call, as no [`proto::Options`] object is
+    /// serialized and decoded in between.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # fn call_act_json(mut actor: valhalla::Actor) {
+    /// use valhalla::proto::options::Action;
+    ///
+    /// let json = r#"{"locations":[{"lat":55.6086,"lon":13.0005},{"lat":55.5944,"lon":13.0002}],"costing":"auto"}"#;
+    /// let response = actor.act_json(Action::Route, json);
+    /// # }
+    /// ```
+    pub fn act_json(
+        &mut self,
+        action: proto::options::Action,
+        json: &str,
+    ) -> Result<Response, Error> {
+        if json.is_empty() {
+            // Empty string is a special for Valhalla, so we should return an error here.
+            return Err(Error("Failed to parse json request".into()));
+        }
+        let response = self.0.as_mut().unwrap().act_json(json, action as i32)?;
+        Ok(Response::from(response))
     }
 
     /// Helper function to convert a Valhalla JSON string into Valhalla PBF request as [`proto::Options`] object.
     /// This function is not optimized for performance and should be considered as a convenience method.
-    /// For best performance construct [`proto::Options`] directly if possible.
+    /// For best performance construct [`proto::Options`] directly if possible, or use [`Actor::act_json()`]
+    /// to execute JSON requests as is.
     pub fn parse_json_request(
         json: &str,
         action: proto::options::Action,
@@ -470,3 +919,96 @@ impl Actor {
         Ok(options)
     }
 }
+
+impl MatrixProfile {
+    /// Travel times from the source to the target for all departure times.
+    pub fn profile(&self, source: u32, target: u32) -> &[f32] {
+        let start = (source * self.targets + target) as usize * self.buckets as usize;
+        &self.times[start..start + self.buckets as usize]
+    }
+
+    /// Travel time from the source to the target for the departure time bucket, or `None` if the
+    /// connection is not found.
+    pub fn time(&self, source: u32, target: u32, bucket: u32) -> Option<f32> {
+        let time = self.profile(source, target)[bucket as usize];
+        time.is_finite().then_some(time)
+    }
+}
+
+/// Incremental map matching session, created by [`Actor::trace_session()`].
+pub struct TraceSession(cxx::UniquePtr<ffi::TraceSession>);
+
+impl TraceSession {
+    /// Adds a new point of the trace with its unix timestamp (or `-1.0` if unknown) and returns points,
+    /// whose match became final, in the trace order. Each point is returned exactly once.
+    pub fn push(&mut self, point: LatLon, time: f64) -> Result<Vec<MatchedPoint>, Error> {
+        Ok(self.0.as_mut().unwrap().push(point.0, point.1, time)?)
+    }
+
+    /// Finalizes the match of all remaining points of the trace, e.g. when the trip is over.
+    pub fn finish(&mut self) -> Result<Vec<MatchedPoint>, Error> {
+        Ok(self.0.as_mut().unwrap().finish()?)
+    }
+}
+
+impl ActionStats {
+    /// Action of the requests, or `None` for actions unknown to this version of the crate.
+    pub fn action(&self) -> Option<proto::options::Action> {
+        proto::options::Action::try_from(self.action).ok()
+    }
+
+    /// Average latency of all requests in milliseconds.
+    pub fn mean_latency_ms(&self) -> f64 {
+        self.total_latency_ms / self.requests.max(1) as f64
+    }
+}
+
+/// Copies the response out and hands its buffer back to the actor, so the next response is written into the
+/// already allocated capacity instead of a new one. Used only for [`Actor::matrix_concise_json()`], the one response
+/// written by the actor itself, as Valhalla serializers always allocate their own buffers.
+fn recycle(actor: std::pin::Pin<&mut ffi::Actor>, response: ffi::Response) -> Response {
+    let result = Response::from(&response);
+    actor.recycle(response.data);
+    result
+}
+
+/// Encodes the request into the reused buffer, keeping its capacity.
+fn encode_into<'a>(request: &proto::Options, buffer: &'a mut Vec<u8>) -> &'a [u8] {
+    buffer.clear();
+    request
+        .encode(buffer)
+        .expect("Vec<u8> grows to fit any message");
+    buffer
+}
+
+/// Appends the route leg, computed as a separate request, to the route in `api`, keeping leg ids consistent.
+fn append_leg(api: &mut proto::Api, leg: proto::Api) {
+    // The first location of the leg is the last location of the route
+    if let (Some(options), Some(leg_options)) = (api.options.as_mut(), leg.options) {
+        options
+            .locations
+            .extend(leg_options.locations.into_iter().skip(1));
+    }
+
+    let trip_route = api.trip.as_mut().and_then(|trip| trip.routes.first_mut());
+    let leg_trip_route = leg.trip.and_then(|trip| trip.routes.into_iter().next());
+    if let (Some(route), Some(leg_route)) = (trip_route, leg_trip_route) {
+        route.legs.extend(leg_route.legs);
+        let leg_count = route.legs.len() as u32;
+        for (leg_id, leg) in route.legs.iter_mut().enumerate() {
+            leg.leg_id = leg_id as u32;
+            leg.leg_count = leg_count;
+        }
+    }
+
+    let directions_route = api.directions.as_mut().and_then(|d| d.routes.first_mut());
+    let leg_directions_route = leg.directions.and_then(|d| d.routes.into_iter().next());
+    if let (Some(route), Some(leg_route)) = (directions_route, leg_directions_route) {
+        route.legs.extend(leg_route.legs);
+        let leg_count = route.legs.len() as u32;
+        for (leg_id, leg) in route.legs.iter_mut().enumerate() {
+            leg.leg_id = leg_id as u32;
+            leg.leg_count = leg_count;
+        }
+    }
+}
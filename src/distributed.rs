@@ -0,0 +1,194 @@
+//! Coordinator for requests that are too large for a single [`Actor`], splitting them over several workers.
+//!
+//! Workers are abstracted by the [`MatrixWorker`] trait, so they can be local actors, actors on dedicated threads
+//! behind a [`ChannelWorker`] or clients of remote processes, serving the same tileset.
+
+use std::{
+    sync::mpsc,
+    thread::{self, JoinHandle},
+};
+
+use prost::Message;
+
+use crate::{Actor, Config, Error, Response, actor::ffi, proto, proto::options::Format};
+
+/// Executor of matrix requests for a block of matrix rows, see [`matrix()`].
+pub trait MatrixWorker: Send {
+    /// Computes the matrix for the request, which always asks for [`Format::Pbf`] output with the matrix and
+    /// options selected, so blocks can be merged without loss.
+    fn compute_matrix(&mut self, request: &proto::Options) -> Result<proto::Api, Error>;
+}
+
+impl MatrixWorker for Actor {
+    fn compute_matrix(&mut self, request: &proto::Options) -> Result<proto::Api, Error> {
+        match self.matrix(request)? {
+            Response::Pbf(api) => Ok(*api),
+            _ => Err(Error("Expected PBF response for a matrix block".into())),
+        }
+    }
+}
+
+/// [`MatrixWorker`] that owns an [`Actor`] on a dedicated thread and exchanges serialized requests and responses
+/// with it over channels. Stands in for a socket transport to a worker process: everything that crosses the
+/// channel is encoded exactly as it would be on the wire.
+pub struct ChannelWorker {
+    requests: Option<mpsc::Sender<Vec<u8>>>,
+    responses: mpsc::Receiver<Result<Vec<u8>, Error>>,
+    thread: Option<JoinHandle<()>>,
+}
+
+impl ChannelWorker {
+    /// Starts a worker thread with a new [`Actor`] created from the config.
+    pub fn spawn(config: &Config) -> Result<Self, Error> {
+        let mut actor = Actor::new(config)?;
+        let (requests, request_rx) = mpsc::channel::<Vec<u8>>();
+        let (response_tx, responses) = mpsc::channel();
+        let thread = thread::spawn(move || {
+            for request in request_rx {
+                let response = proto::Options::decode(request.as_slice())
+                    .map_err(|err| Error(err.to_string().into()))
+                    .and_then(|request| actor.compute_matrix(&request))
+                    .map(|api| api.encode_to_vec());
+                if response_tx.send(response).is_err() {
+                    break;
+                }
+            }
+        });
+        Ok(Self {
+            requests: Some(requests),
+            responses,
+            thread: Some(thread),
+        })
+    }
+}
+
+impl MatrixWorker for ChannelWorker {
+    fn compute_matrix(&mut self, request: &proto::Options) -> Result<proto::Api, Error> {
+        let disconnected = || Error("Matrix worker is disconnected".into());
+        let requests = self.requests.as_ref().ok_or_else(disconnected)?;
+        requests
+            .send(request.encode_to_vec())
+            .map_err(|_| disconnected())?;
+        let response = self.responses.recv().map_err(|_| disconnected())??;
+        proto::Api::decode(response.as_slice()).map_err(|err| Error(err.to_string().into()))
+    }
+}
+
+impl Drop for ChannelWorker {
+    fn drop(&mut self) {
+        // Closing the channel stops the worker loop
+        self.requests.take();
+        if let Some(thread) = self.thread.take() {
+            let _ = thread.join();
+        }
+    }
+}
+
+/// Computes a time-distance matrix by splitting its rows over `workers` and merging the computed blocks.
+///
+/// Sources are split into contiguous blocks of similar size, one per worker, and each block is computed against
+/// all targets in parallel. Blocks are merged in the source order with their source indices shifted to the
+/// position of the block, and the result is serialized in the requested format. As each worker only keeps its
+/// own block in the search state, the largest feasible matrix grows with the number of workers.
+///
+/// Valhalla selects the matrix algorithm by the request shape, so many-to-many requests are split into blocks of
+/// at least two sources to be computed with the same algorithm as the whole request, and blocks computed with
+/// different algorithms are rejected. Each source is expanded independently of the other sources, so the merged
+/// times and distances are the same as [`Actor::matrix()`] gives for the whole request.
+///
+/// Only as many workers as there are blocks are used. All workers serve the whole tileset, so routes never
+/// cross worker boundaries: workers scale the search state, not the tile cache. Partition-aware workers that
+/// serve only a [`GraphReader::subset`](crate::GraphReader::subset) of the tiles would need paths to be stitched
+/// across [`Partitioning::boundary_edges`](crate::graph_tools::Partitioning::boundary_edges), which is not
+/// supported.
+///
+/// # Examples
+///
+/// ```
+/// # fn call_matrix(config: &valhalla::Config, request: &valhalla::proto::Options) -> Result<(), valhalla::Error> {
+/// use valhalla::distributed::{self, ChannelWorker};
+///
+/// let mut workers = (0..4)
+///     .map(|_| ChannelWorker::spawn(config))
+///     .collect::<Result<Vec<_>, _>>()?;
+/// let response = distributed::matrix(&mut workers, request)?;
+/// # Ok(())
+/// # }
+/// ```
+pub fn matrix<W: MatrixWorker>(
+    workers: &mut [W],
+    request: &proto::Options,
+) -> Result<Response, Error> {
+    if workers.is_empty() {
+        return Err(Error("At least one worker is required".into()));
+    }
+
+    let sources = &request.sources;
+    // Valhalla picks the matrix algorithm by the shape of the request, e.g. one-to-many requests may be computed
+    // differently, so a many-to-many request is never split into single-source blocks
+    let min_block = if request.targets.len() > 1 { 2 } else { 1 };
+    let blocks = workers.len().min(sources.len() / min_block).max(1);
+    let block_requests: Vec<_> = (0..blocks)
+        .map(|i| {
+            let range = sources.len() * i / blocks..sources.len() * (i + 1) / blocks;
+            let block_request = proto::Options {
+                format: Format::Pbf as i32,
+                pbf_field_selector: Some(proto::PbfFieldSelector {
+                    options: true,
+                    matrix: true,
+                    ..Default::default()
+                }),
+                sources: sources[range.clone()].to_vec(),
+                ..request.clone()
+            };
+            (range.start as u32, block_request)
+        })
+        .collect();
+
+    let results: Vec<_> = thread::scope(|s| {
+        let handles: Vec<_> = workers
+            .iter_mut()
+            .zip(&block_requests)
+            .map(|(worker, (_, block_request))| {
+                s.spawn(move || worker.compute_matrix(block_request))
+            })
+            .collect();
+        handles
+            .into_iter()
+            .map(|handle| handle.join().expect("Matrix block computation panicked"))
+            .collect()
+    });
+
+    let mut results = results.into_iter().zip(&block_requests);
+    let (first, _) = results.next().expect("At least one block is computed");
+    let mut api = first?;
+    let options = api.options.get_or_insert_default();
+    let matrix = api.matrix.get_or_insert_default();
+    for (result, &(first_source, _)) in results {
+        let block_api = result?;
+        let Some(block) = block_api.matrix else {
+            return Err(Error("Matrix block has no matrix".into()));
+        };
+        if block.algorithm != matrix.algorithm {
+            return Err(Error(
+                "Matrix blocks were computed with different algorithms".into(),
+            ));
+        }
+        // Merging the encoded block appends all its per-pair arrays, so only source indices need a fix
+        let merged = matrix.from_indices.len();
+        matrix
+            .merge(block.encode_to_vec().as_slice())
+            .map_err(|err| Error(err.to_string().into()))?;
+        for index in &mut matrix.from_indices[merged..] {
+            *index += first_source;
+        }
+        // Sources are kept as correlated by the workers, the same as in a response for the whole request
+        options
+            .sources
+            .extend(block_api.options.unwrap_or_default().sources);
+    }
+    // Blocks are requested with their own field selector, so the caller's one is restored for the serializer
+    options.format = request.format;
+    options.pbf_field_selector = request.pbf_field_selector.clone();
+    Ok(Response::from(ffi::serialize_matrix(&api.encode_to_vec())?))
+}
@@ -0,0 +1,487 @@
+#include "edge_index.hpp"
+#include "valhalla/src/edge_index.rs.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <numbers>
+#include <thread>
+
+namespace baldr = valhalla::baldr;
+namespace midgard = valhalla::midgard;
+
+// Hot numeric kernels are compiled for several instruction sets and the best one for the CPU is picked by the dynamic
+// loader at startup, so AVX2 and AVX-512 are used where available without building for the host CPU. Only loops whose
+// whole body is compiled in this crate benefit: e.g. `decode_weekly_speeds()` loops over 2016 buckets, but each one is
+// a call to `baldr::decompress_speed_bucket()`, whose dot product and cosine table live in Valhalla's library, so a
+// clone of that loop would still run the same baseline code per bucket.
+#if defined(__x86_64__) && defined(__ELF__)
+#define TARGET_CLONES __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define TARGET_CLONES
+#endif
+
+namespace {
+
+constexpr double kMetersPerDegree = 111319.49;
+
+/// Projection of a point onto the edge shape.
+struct Projection {
+  float distance = std::numeric_limits<float>::max();
+  /// Fraction of the shape length from its start to the projected point.
+  float percent_along = 0.0f;
+  midgard::PointLL point;
+};
+
+/// Projects the point onto the shape using equirectangular approximation around the point, which is precise
+/// enough for distances within typical search radiuses and much cheaper than the great circle math.
+Projection project(const midgard::PointLL& p, const std::vector<midgard::PointLL>& shape) {
+  Projection projection;
+  if (shape.empty()) {
+    return projection;
+  }
+
+  const double lon_scale = std::cos(p.lat() * std::numbers::pi / 180.0);
+  double best_sq = std::numeric_limits<double>::max();
+  double best_along = 0.0;
+  double best_x = (shape[0].lng() - p.lng()) * lon_scale;
+  double best_y = shape[0].lat() - p.lat();
+  double total = 0.0;
+  for (size_t i = 0; i + 1 < shape.size(); ++i) {
+    const double ax = (shape[i].lng() - p.lng()) * lon_scale;
+    const double ay = shape[i].lat() - p.lat();
+    const double dx = (shape[i + 1].lng() - p.lng()) * lon_scale - ax;
+    const double dy = shape[i + 1].lat() - p.lat() - ay;
+    const double length_sq = dx * dx + dy * dy;
+    const double t = length_sq > 0.0 ? std::clamp(-(ax * dx + ay * dy) / length_sq, 0.0, 1.0) : 0.0;
+    const double x = ax + t * dx;
+    const double y = ay + t * dy;
+    const double length = std::sqrt(length_sq);
+    if (x * x + y * y < best_sq) {
+      best_sq = x * x + y * y;
+      best_along = total + t * length;
+      best_x = x;
+      best_y = y;
+    }
+    total += length;
+  }
+
+  projection.distance = static_cast<float>(std::sqrt(best_x * best_x + best_y * best_y) * kMetersPerDegree);
+  projection.percent_along = total > 0.0 ? static_cast<float>(best_along / total) : 0.0f;
+  projection.point = midgard::PointLL(p.lng() + best_x / lon_scale, p.lat() + best_y);
+  return projection;
+}
+
+/// Squared distances from the point at `(x0, y0)` to each segment of the shape and positions of the projections along
+/// the segments. Longitudes are scaled by `lon_scale` to make the space locally isometric. The loop is branch-free
+/// over contiguous arrays, so compilers vectorize it for each of [`TARGET_CLONES`].
+TARGET_CLONES void project_segments(const float* __restrict xs, const float* __restrict ys, size_t segments,
+                                    float x0, float y0, float lon_scale, float* __restrict dist_sq,
+                                    float* __restrict along, float* __restrict lengths) {
+  for (size_t i = 0; i < segments; ++i) {
+    const float ax = (xs[i] - x0) * lon_scale;
+    const float ay = ys[i] - y0;
+    const float dx = (xs[i + 1] - xs[i]) * lon_scale;
+    const float dy = ys[i + 1] - ys[i];
+    const float length_sq = dx * dx + dy * dy;
+    // Degenerate segments have zero dot product, so `t` is zero for them as well
+    const float t =
+        std::clamp(-(ax * dx + ay * dy) / std::max(length_sq, std::numeric_limits<float>::min()), 0.0f, 1.0f);
+    const float x = ax + t * dx;
+    const float y = ay + t * dy;
+    dist_sq[i] = x * x + y * y;
+    along[i] = t;
+    lengths[i] = std::sqrt(length_sq);
+  }
+}
+
+/// Same as [`project()`] but over the pre-decoded shape of the `record`. `scratch` is reused between calls to avoid
+/// allocations.
+Projection project(const EdgeIndex::ShapeStore& shapes, uint32_t record, const midgard::PointLL& p,
+                   std::vector<float>& scratch) {
+  const size_t begin = shapes.offsets[record];
+  const size_t end = shapes.offsets[record + 1];
+  const double origin_lon = shapes.origins[2 * record];
+  const double origin_lat = shapes.origins[2 * record + 1];
+  const float x0 = static_cast<float>(p.lng() - origin_lon);
+  const float y0 = static_cast<float>(p.lat() - origin_lat);
+  const float lon_scale = static_cast<float>(std::cos(p.lat() * std::numbers::pi / 180.0));
+  const float* xs = shapes.xs.data() + begin;
+  const float* ys = shapes.ys.data() + begin;
+
+  Projection projection;
+  if (begin == end) {
+    return projection;
+  }
+
+  float best_x = (xs[0] - x0) * lon_scale;
+  float best_y = ys[0] - y0;
+  double best_along = 0.0;
+  double total = 0.0;
+  const size_t segments = end - begin - 1;
+  if (segments > 0) {
+    scratch.resize(segments * 3);
+    float* dist_sq = scratch.data();
+    float* along = dist_sq + segments;
+    float* lengths = along + segments;
+    project_segments(xs, ys, segments, x0, y0, lon_scale, dist_sq, along, lengths);
+
+    const size_t best = std::distance(dist_sq, std::min_element(dist_sq, dist_sq + segments));
+    for (size_t i = 0; i < segments; ++i) {
+      if (i == best) {
+        best_along = total + along[i] * lengths[i];
+      }
+      total += lengths[i];
+    }
+    best_x = (xs[best] - x0 + along[best] * (xs[best + 1] - xs[best])) * lon_scale;
+    best_y = ys[best] - y0 + along[best] * (ys[best + 1] - ys[best]);
+  }
+
+  projection.distance = std::sqrt(best_x * best_x + best_y * best_y) * static_cast<float>(kMetersPerDegree);
+  projection.percent_along = total > 0.0 ? static_cast<float>(best_along / total) : 0.0f;
+  projection.point = midgard::PointLL(p.lng() + best_x / lon_scale, p.lat() + best_y);
+  return projection;
+}
+
+/// Part of the index built by a single thread from a contiguous range of tiles.
+struct PartialIndex {
+  std::vector<EdgeIndex::Record> records;
+  /// (cell key, local record index) pairs.
+  std::vector<std::pair<uint64_t, uint32_t>> entries;
+
+  /// Decoded shapes, only filled when requested. Number of shape points per record.
+  std::vector<uint64_t> shape_sizes;
+  std::vector<double> origins;
+  std::vector<float> xs;
+  std::vector<float> ys;
+};
+
+/// Backing storage of decoded shapes built in memory.
+struct OwnedShapes {
+  std::vector<uint64_t> offsets;
+  std::vector<double> origins;
+  std::vector<float> xs;
+  std::vector<float> ys;
+};
+
+/// Header of the decoded shapes sidecar file, followed by offsets, origins, longitudes and latitudes arrays.
+struct ShapeFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t records;
+  /// Hash of the index records to detect sidecar files built for another tileset.
+  uint64_t records_hash;
+  uint64_t points;
+};
+
+constexpr char kShapeFileMagic[8] = { 'V', 'H', 'S', 'H', 'A', 'P', 'E', 'S' };
+constexpr uint32_t kShapeFileVersion = 1;
+
+/// FNV-1a over the directed edge ids of all records.
+uint64_t records_hash(const std::vector<EdgeIndex::Record>& records) {
+  uint64_t hash = 14695981039346656037ull;
+  for (const auto& record : records) {
+    for (const uint64_t value : { record.edge.value, record.opp_edge.value }) {
+      hash = (hash ^ value) * 1099511628211ull;
+    }
+  }
+  return hash;
+}
+
+void index_tiles(const EdgeIndex& index, std::span<const baldr::GraphId> tile_ids, bool decode_shapes,
+                 PartialIndex& out) {
+  const TileSet& tileset = *index.tileset_;
+  // Tiles on the other side of the edges that leave the tile, required to find opposing edges
+  std::unordered_map<uint64_t, baldr::graph_tile_ptr> end_tiles;
+
+  for (const auto tile_id : tile_ids) {
+    const baldr::graph_tile_ptr tile(tileset.get_graph_tile(tile_id), false);
+    if (!tile) {
+      continue;
+    }
+
+    const auto edges = tile->GetDirectedEdges();
+    for (uint32_t i = 0; i < edges.size(); ++i) {
+      const auto& de = edges[i];
+      // Opposing edges share the same shape, so it's enough to index only one of them
+      if (de.is_shortcut() || !de.forward()) {
+        continue;
+      }
+
+      const auto end_node = de.endnode();
+      auto end_tile = tile;
+      if (de.leaves_tile()) {
+        auto [it, inserted] = end_tiles.try_emplace(end_node.tile_base());
+        if (inserted) {
+          it->second = baldr::graph_tile_ptr(tileset.get_graph_tile(end_node), false);
+        }
+        end_tile = it->second;
+      }
+      baldr::GraphId opp_edge;
+      if (end_tile && end_node.id() < end_tile->header()->nodecount()) {
+        const auto* node = end_tile->node(end_node.id());
+        opp_edge = baldr::GraphId(end_node.tileid(), end_node.level(), node->edge_index() + de.opp_index());
+      }
+
+      const auto record = static_cast<uint32_t>(out.records.size());
+      out.records.push_back(EdgeIndex::Record{
+        .edge = baldr::GraphId(tile_id.tileid(), tile_id.level(), i),
+        .opp_edge = opp_edge,
+      });
+
+      // Every cell covered by the bounding box of each segment. Duplicates are removed after the merge.
+      const auto shape = tile->edgeinfo(&de).shape();
+      if (decode_shapes) {
+        const auto origin = shape.empty() ? midgard::PointLL(0.0, 0.0) : shape.front();
+        out.shape_sizes.push_back(shape.size());
+        out.origins.insert(out.origins.end(), { origin.lng(), origin.lat() });
+        for (const auto& point : shape) {
+          out.xs.push_back(static_cast<float>(point.lng() - origin.lng()));
+          out.ys.push_back(static_cast<float>(point.lat() - origin.lat()));
+        }
+      }
+      for (size_t j = 0; j < shape.size(); ++j) {
+        const auto& a = shape[j];
+        const auto& b = j + 1 < shape.size() ? shape[j + 1] : a;
+        const uint64_t first = index.cell_key(std::min(a.lat(), b.lat()), std::min(a.lng(), b.lng()));
+        const uint64_t last = index.cell_key(std::max(a.lat(), b.lat()), std::max(a.lng(), b.lng()));
+        for (uint64_t row = first / index.columns_; row <= last / index.columns_; ++row) {
+          for (uint64_t column = first % index.columns_; column <= last % index.columns_; ++column) {
+            out.entries.emplace_back(row * index.columns_ + column, record);
+          }
+        }
+      }
+    }
+  }
+}
+
+}  // namespace
+
+uint64_t EdgeIndex::cell_key(double lat, double lon) const {
+  const auto rows = static_cast<uint64_t>(std::ceil(180.0 / cell_size_));
+  const auto row = static_cast<uint64_t>(std::clamp((lat + 90.0) / cell_size_, 0.0, static_cast<double>(rows - 1)));
+  const auto column =
+      static_cast<uint64_t>(std::clamp((lon + 180.0) / cell_size_, 0.0, static_cast<double>(columns_ - 1)));
+  return row * columns_ + column;
+}
+
+rust::Vec<EdgeCandidate> EdgeIndex::nearest(double lat, double lon, float radius, uint32_t limit) const {
+  const midgard::PointLL point(lon, lat);
+  const double lat_delta = radius / kMetersPerDegree;
+  const double lon_delta = lat_delta / std::max(std::cos(lat * std::numbers::pi / 180.0), 0.01);
+  const uint64_t first = cell_key(lat - lat_delta, lon - lon_delta);
+  const uint64_t last = cell_key(lat + lat_delta, lon + lon_delta);
+
+  std::vector<uint32_t> found;
+  for (uint64_t row = first / columns_; row <= last / columns_; ++row) {
+    const uint64_t row_begin = row * columns_ + first % columns_;
+    const uint64_t row_end = row * columns_ + last % columns_;
+    // Cells in the same row have consecutive keys
+    auto it = std::lower_bound(cell_keys_.begin(), cell_keys_.end(), row_begin);
+    for (; it != cell_keys_.end() && *it <= row_end; ++it) {
+      const auto cell = std::distance(cell_keys_.begin(), it);
+      found.insert(found.end(), cell_records_.begin() + cell_offsets_[cell],
+                   cell_records_.begin() + cell_offsets_[cell + 1]);
+    }
+  }
+  // Sorting also groups records by tile, so each tile is fetched only once
+  std::sort(found.begin(), found.end());
+  found.erase(std::unique(found.begin(), found.end()), found.end());
+
+  std::vector<std::pair<Projection, uint32_t>> hits;
+  if (shapes_) {
+    std::vector<float> scratch;
+    for (const auto record_index : found) {
+      const auto projection = project(*shapes_, record_index, point, scratch);
+      if (projection.distance <= radius) {
+        hits.emplace_back(projection, record_index);
+      }
+    }
+  } else {
+    baldr::graph_tile_ptr tile;
+    for (const auto record_index : found) {
+      const auto& record = records_[record_index];
+      if (!tile || tile->id() != record.edge.tile_base()) {
+        tile = baldr::graph_tile_ptr(tileset_->get_graph_tile(record.edge), false);
+      }
+      const auto* de = tile->directededge(record.edge.id());
+      const auto projection = project(point, tile->edgeinfo(de).shape());
+      if (projection.distance <= radius) {
+        hits.emplace_back(projection, record_index);
+      }
+    }
+  }
+  std::sort(hits.begin(), hits.end(),
+            [](const auto& a, const auto& b) { return a.first.distance < b.first.distance; });
+  hits.resize(std::min<size_t>(hits.size(), limit));
+
+  rust::Vec<EdgeCandidate> candidates;
+  candidates.reserve(hits.size() * 2);
+  for (const auto& [projection, record_index] : hits) {
+    const auto& record = records_[record_index];
+    candidates.push_back(EdgeCandidate{
+      .edge = record.edge,
+      .distance = projection.distance,
+      .percent_along = projection.percent_along,
+      .lat = projection.point.lat(),
+      .lon = projection.point.lng(),
+    });
+    if (record.opp_edge.Is_Valid()) {
+      candidates.push_back(EdgeCandidate{
+        .edge = record.opp_edge,
+        .distance = projection.distance,
+        .percent_along = 1.0f - projection.percent_along,
+        .lat = projection.point.lat(),
+        .lon = projection.point.lng(),
+      });
+    }
+  }
+  return candidates;
+}
+
+void EdgeIndex::save_shapes(rust::Slice<const uint8_t> path) const {
+  if (!shapes_) {
+    throw std::runtime_error("Edge index has no decoded shapes to save");
+  }
+
+  ShapeFileHeader header{};
+  std::memcpy(header.magic, kShapeFileMagic, sizeof(header.magic));
+  header.version = kShapeFileVersion;
+  header.records = records_.size();
+  header.records_hash = records_hash(records_);
+  header.points = shapes_->xs.size();
+
+  const std::string file(reinterpret_cast<const char*>(path.data()), path.size());
+  std::ofstream out(file, std::ios::binary | std::ios::trunc);
+  const auto write = [&out](const auto& data) {
+    out.write(reinterpret_cast<const char*>(data.data()), data.size_bytes());
+  };
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  write(shapes_->offsets);
+  write(shapes_->origins);
+  write(shapes_->xs);
+  write(shapes_->ys);
+  if (!out.flush()) {
+    throw std::runtime_error("Failed to write decoded shapes to " + file);
+  }
+}
+
+void EdgeIndex::load_shapes(rust::Slice<const uint8_t> path) {
+  const std::string file(reinterpret_cast<const char*>(path.data()), path.size());
+  auto [storage, size] = map_file(path);
+  if (size < sizeof(ShapeFileHeader)) {
+    throw std::runtime_error("Invalid decoded shapes file " + file);
+  }
+  const void* data = storage.get();
+
+  ShapeFileHeader header;
+  std::memcpy(&header, data, sizeof(header));
+  // Counts larger than the file itself would overflow the expected size below
+  if (header.records >= size || header.points >= size) {
+    throw std::runtime_error("Invalid decoded shapes file " + file);
+  }
+  const size_t expected_size = sizeof(header) + (header.records + 1) * sizeof(uint64_t) +
+                               header.records * 2 * sizeof(double) + header.points * 2 * sizeof(float);
+  if (std::memcmp(header.magic, kShapeFileMagic, sizeof(header.magic)) != 0 || header.version != kShapeFileVersion ||
+      expected_size != size) {
+    throw std::runtime_error("Invalid decoded shapes file " + file);
+  }
+  if (header.records != records_.size() || header.records_hash != records_hash(records_)) {
+    throw std::runtime_error("Decoded shapes file " + file + " was built for another tileset");
+  }
+
+  const auto* bytes = static_cast<const std::byte*>(data) + sizeof(header);
+  ShapeStore shapes{ .storage = std::move(storage) };
+  shapes.offsets = { reinterpret_cast<const uint64_t*>(bytes), header.records + 1 };
+  // Shapes are sliced by offsets without bounds checks, so a corrupted file must not pass beyond this point
+  if (shapes.offsets.front() != 0 || shapes.offsets.back() != header.points ||
+      !std::is_sorted(shapes.offsets.begin(), shapes.offsets.end())) {
+    throw std::runtime_error("Invalid decoded shapes file " + file);
+  }
+  bytes += shapes.offsets.size_bytes();
+  shapes.origins = { reinterpret_cast<const double*>(bytes), header.records * 2 };
+  bytes += shapes.origins.size_bytes();
+  shapes.xs = { reinterpret_cast<const float*>(bytes), header.points };
+  bytes += shapes.xs.size_bytes();
+  shapes.ys = { reinterpret_cast<const float*>(bytes), header.points };
+  shapes_ = std::move(shapes);
+}
+
+std::shared_ptr<EdgeIndex> new_edge_index(const std::shared_ptr<TileSet>& tileset, double cell_size, bool decode_shapes,
+                                          rust::Slice<const uint8_t> shapes_path) {
+  if (!(cell_size > 0.0 && cell_size <= 1.0)) {
+    throw std::runtime_error("Cell size must be in (0, 1] degrees range");
+  }
+
+  auto index = std::make_shared<EdgeIndex>();
+  index->tileset_ = tileset;
+  index->cell_size_ = cell_size;
+  index->columns_ = static_cast<uint64_t>(std::ceil(360.0 / cell_size));
+
+  // Sorted tiles make the index layout deterministic and keep records of the same tile together
+  std::vector<baldr::GraphId> tile_ids;
+  tile_ids.reserve(tileset->tiles_.size());
+  for (const auto& tile : tileset->tiles_) {
+    tile_ids.emplace_back(tile.first);
+  }
+  std::sort(tile_ids.begin(), tile_ids.end());
+
+  const size_t thread_count = std::clamp<size_t>(std::thread::hardware_concurrency(), 1, tile_ids.size() + 1);
+  const size_t chunk_size = (tile_ids.size() + thread_count - 1) / thread_count;
+  std::vector<PartialIndex> partials(thread_count);
+  {
+    std::vector<std::jthread> threads;
+    for (size_t i = 0; i < thread_count; ++i) {
+      const size_t begin = std::min(i * chunk_size, tile_ids.size());
+      const size_t end = std::min(begin + chunk_size, tile_ids.size());
+      // Shapes from the sidecar file replace decoded ones, so there is no need to decode them here
+      threads.emplace_back(index_tiles, std::cref(*index), std::span(tile_ids).subspan(begin, end - begin),
+                           decode_shapes && shapes_path.empty(), std::ref(partials[i]));
+    }
+  }
+
+  std::vector<std::pair<uint64_t, uint32_t>> entries;
+  auto owned = std::make_shared<OwnedShapes>();
+  owned->offsets.push_back(0);
+  for (auto& partial : partials) {
+    const auto offset = static_cast<uint32_t>(index->records_.size());
+    index->records_.insert(index->records_.end(), partial.records.begin(), partial.records.end());
+    for (const auto& [key, record] : partial.entries) {
+      entries.emplace_back(key, record + offset);
+    }
+    for (const auto shape_size : partial.shape_sizes) {
+      owned->offsets.push_back(owned->offsets.back() + shape_size);
+    }
+    owned->origins.insert(owned->origins.end(), partial.origins.begin(), partial.origins.end());
+    owned->xs.insert(owned->xs.end(), partial.xs.begin(), partial.xs.end());
+    owned->ys.insert(owned->ys.end(), partial.ys.begin(), partial.ys.end());
+    partial = {};
+  }
+  std::sort(entries.begin(), entries.end());
+  entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+
+  index->cell_records_.reserve(entries.size());
+  for (const auto& [key, record] : entries) {
+    if (index->cell_keys_.empty() || index->cell_keys_.back() != key) {
+      index->cell_keys_.push_back(key);
+      index->cell_offsets_.push_back(index->cell_records_.size());
+    }
+    index->cell_records_.push_back(record);
+  }
+  index->cell_offsets_.push_back(index->cell_records_.size());
+
+  if (!shapes_path.empty()) {
+    index->load_shapes(shapes_path);
+  } else if (decode_shapes) {
+    index->shapes_ = EdgeIndex::ShapeStore{
+      .storage = owned,
+      .offsets = owned->offsets,
+      .origins = owned->origins,
+      .xs = owned->xs,
+      .ys = owned->ys,
+    };
+  }
+
+  return index;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "libvalhalla.hpp"
+
+#include <optional>
+#include <span>
+
+// Forward Declarations for shared types, defined in edge_index.rs
+struct EdgeCandidate;
+
+/// Immutable spatial index over edge shapes of the whole [`TileSet`], built once and shared between threads.
+///
+/// Edges are bucketed into a sparse uniform grid of `cell_size` degrees. Only occupied cells are stored, sorted by
+/// their key, so lookups are a binary search away and no locking is required as nothing is mutated after the build.
+struct EdgeIndex {
+  /// Pair of opposing directed edges that share the same shape.
+  struct Record {
+    /// Directed edge which direction matches the direction of the shape in `EdgeInfo`.
+    valhalla::baldr::GraphId edge;
+    valhalla::baldr::GraphId opp_edge;
+  };
+
+  std::shared_ptr<TileSet> tileset_;
+  double cell_size_;
+  uint64_t columns_;
+
+  /// Records are ordered by tile to access the same tile for consecutive records during the search.
+  std::vector<Record> records_;
+  /// Sorted keys of non-empty grid cells.
+  std::vector<uint64_t> cell_keys_;
+  /// `cell_records_[cell_offsets_[i]..cell_offsets_[i + 1]]` are records in the `cell_keys_[i]` cell.
+  std::vector<size_t> cell_offsets_;
+  std::vector<uint32_t> cell_records_;
+
+  /// Optional store of pre-decoded edge shapes, indexed by record. Points are kept as `float` offsets from the
+  /// per-record origin in separate longitude/latitude columns, so projections run over contiguous arrays instead of
+  /// decoding varint-encoded shapes from `EdgeInfo` on each lookup.
+  struct ShapeStore {
+    /// Owns the memory behind the spans below: either in-memory arrays or a memory-mapped sidecar file.
+    std::shared_ptr<const void> storage;
+    /// `xs[offsets[i]..offsets[i + 1]]` are points of the `i`-th record shape.
+    std::span<const uint64_t> offsets;
+    /// Longitude and latitude of the first shape point per record, interleaved.
+    std::span<const double> origins;
+    std::span<const float> xs;
+    std::span<const float> ys;
+  };
+  std::optional<ShapeStore> shapes_;
+
+  size_t size() const { return records_.size(); }
+  bool has_decoded_shapes() const { return shapes_.has_value(); }
+
+  /// Finds edges within `radius` meters from the given point, sorted by distance. Both directed edges of the road
+  /// are returned, so up to `2 * limit` candidates can be returned.
+  rust::Vec<EdgeCandidate> nearest(double lat, double lon, float radius, uint32_t limit) const;
+
+  uint64_t cell_key(double lat, double lon) const;
+
+  /// Writes decoded shapes into a sidecar file that can be memory-mapped by [`new_edge_index()`] later on.
+  void save_shapes(rust::Slice<const uint8_t> path) const;
+  /// Memory-maps decoded shapes, previously written by [`EdgeIndex::save_shapes()`] for the same tileset.
+  void load_shapes(rust::Slice<const uint8_t> path);
+};
+
+/// Builds an [`EdgeIndex`] over all edges in the tileset, except shortcuts that duplicate regular edges.
+/// Decoded shapes are memory-mapped from `shapes_path` if it's not empty, or decoded in memory if `decode_shapes` is
+/// set.
+std::shared_ptr<EdgeIndex> new_edge_index(const std::shared_ptr<TileSet>& tileset, double cell_size, bool decode_shapes,
+                                          rust::Slice<const uint8_t> shapes_path);
@@ -0,0 +1,123 @@
+use std::{os::unix::ffi::OsStrExt, path::Path};
+
+use crate::{Error, GraphReader, LatLon};
+
+pub use ffi::EdgeCandidate;
+
+#[cxx::bridge]
+pub(crate) mod ffi {
+    /// Directed edge found near the requested point.
+    #[derive(Clone, Copy, Debug)]
+    struct EdgeCandidate {
+        edge: GraphId,
+        /// Distance in meters from the requested point to the edge shape.
+        distance: f32,
+        /// Position of the closest point along the edge, from `0.0` at its start to `1.0` at its end.
+        percent_along: f32,
+        /// Closest point on the edge shape.
+        lat: f64,
+        lon: f64,
+    }
+
+    unsafe extern "C++" {
+        include!("valhalla/src/edge_index.hpp");
+
+        #[namespace = "valhalla::baldr"]
+        type GraphId = crate::GraphId;
+        type TileSet = crate::ffi::TileSet;
+
+        type EdgeIndex;
+        fn new_edge_index(
+            tileset: &SharedPtr<TileSet>,
+            cell_size: f64,
+            decode_shapes: bool,
+            shapes_path: &[u8],
+        ) -> Result<SharedPtr<EdgeIndex>>;
+        fn size(self: &EdgeIndex) -> usize;
+        fn has_decoded_shapes(self: &EdgeIndex) -> bool;
+        fn save_shapes(self: &EdgeIndex, path: &[u8]) -> Result<()>;
+        fn nearest(
+            self: &EdgeIndex,
+            lat: f64,
+            lon: f64,
+            radius: f32,
+            limit: u32,
+        ) -> Vec<EdgeCandidate>;
+    }
+}
+
+unsafe impl Send for ffi::EdgeIndex {}
+unsafe impl Sync for ffi::EdgeIndex {}
+
+/// Spatial index over shapes of all edges in the tileset to find edges near arbitrary points.
+///
+/// The index is built once and is immutable afterwards, so cloning is cheap and a single instance can
+/// be shared by any number of threads without locking. It keeps the [`GraphReader`] it was built from
+/// alive and reads edge shapes directly from the memory mapped tiles.
+#[derive(Clone)]
+pub struct EdgeIndex(pub(crate) cxx::SharedPtr<ffi::EdgeIndex>);
+
+impl EdgeIndex {
+    /// Grid cell size in degrees used by [`EdgeIndex::new`], roughly 550 meters along the meridian.
+    pub const DEFAULT_CELL_SIZE: f64 = 0.005;
+
+    /// Builds the index over all edges in the tileset, using all available cores.
+    pub fn new(reader: &GraphReader) -> Result<Self, Error> {
+        Self::with_cell_size(reader, Self::DEFAULT_CELL_SIZE)
+    }
+
+    /// Builds the index with the given grid cell size in degrees. Smaller cells make searches with
+    /// small radiuses faster at the cost of the index size.
+    pub fn with_cell_size(reader: &GraphReader, cell_size: f64) -> Result<Self, Error> {
+        Ok(Self(ffi::new_edge_index(&reader.0, cell_size, false, &[])?))
+    }
+
+    /// Builds the index and additionally decodes all edge shapes into flat in-memory arrays, so
+    /// searches project points without decoding shapes from the tiles. This trades memory (roughly
+    /// 8 bytes per shape point) for several times faster [`EdgeIndex::nearest`] calls.
+    ///
+    /// Decoded shapes can be saved with [`EdgeIndex::save_shapes`] and memory-mapped later by
+    /// [`EdgeIndex::with_shapes_file`] to skip decoding on startup.
+    pub fn with_decoded_shapes(reader: &GraphReader, cell_size: f64) -> Result<Self, Error> {
+        Ok(Self(ffi::new_edge_index(&reader.0, cell_size, true, &[])?))
+    }
+
+    /// Builds the index and memory-maps decoded shapes from the sidecar file written by
+    /// [`EdgeIndex::save_shapes`]. Fails if the file was built for another tileset.
+    pub fn with_shapes_file(
+        reader: &GraphReader,
+        cell_size: f64,
+        path: impl AsRef<Path>,
+    ) -> Result<Self, Error> {
+        let path = path.as_ref().as_os_str().as_bytes();
+        Ok(Self(ffi::new_edge_index(
+            &reader.0, cell_size, false, path,
+        )?))
+    }
+
+    /// Writes decoded shapes into a sidecar file. Fails if the index was built without them.
+    pub fn save_shapes(&self, path: impl AsRef<Path>) -> Result<(), Error> {
+        Ok(self.0.save_shapes(path.as_ref().as_os_str().as_bytes())?)
+    }
+
+    /// Whether searches use pre-decoded shapes instead of decoding them from the tiles.
+    pub fn has_decoded_shapes(&self) -> bool {
+        self.0.has_decoded_shapes()
+    }
+
+    /// Number of indexed roads, i.e. pairs of opposing directed edges.
+    pub fn len(&self) -> usize {
+        self.0.size()
+    }
+
+    /// Whether the index has no edges at all.
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    /// Finds up to `limit` closest roads within `radius` meters from the given point, sorted by distance.
+    /// Both directed edges of each road are returned as separate candidates.
+    pub fn nearest(&self, point: LatLon, radius: f32, limit: u32) -> Vec<EdgeCandidate> {
+        self.0.nearest(point.0, point.1, radius, limit)
+    }
+}
@@ -0,0 +1,1173 @@
+#include "graph_tools.hpp"
+#include "valhalla/src/edge_index.rs.h"
+#include "valhalla/src/graph_tools.rs.h"
+
+#include <valhalla/baldr/tilehierarchy.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <numbers>
+#include <numeric>
+#include <optional>
+#include <queue>
+#include <thread>
+
+namespace baldr = valhalla::baldr;
+namespace sif = valhalla::sif;
+
+namespace {
+
+size_t worker_count() {
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+/// Runs `fn(worker, i)` for each `i` in `[0, count)` on [`worker_count()`] threads. Tiles differ in size a lot, so
+/// workers pull items one by one from a shared counter instead of processing fixed ranges.
+template <typename F>
+void parallel_for(size_t count, const F& fn) {
+  std::atomic<size_t> next = 0;
+  std::vector<std::jthread> threads;
+  for (size_t worker = 0; worker < worker_count(); ++worker) {
+    threads.emplace_back([&, worker] {
+      for (size_t i = next++; i < count; i = next++) {
+        fn(worker, i);
+      }
+    });
+  }
+}
+
+std::vector<baldr::GraphId> sorted_tile_ids(const TileSet& tileset) {
+  std::vector<baldr::GraphId> tile_ids;
+  tile_ids.reserve(tileset.tiles_.size());
+  for (const auto& tile : tileset.tiles_) {
+    tile_ids.emplace_back(tile.first);
+  }
+  std::sort(tile_ids.begin(), tile_ids.end());
+  return tile_ids;
+}
+
+std::string to_string(baldr::GraphId id) {
+  return std::to_string(id.level()) + "/" + std::to_string(id.tileid()) + "/" + std::to_string(id.id());
+}
+
+/// Tiles loaded by a single worker. Neighbouring tiles are requested over and over again, so keeping them around
+/// saves constructing a `GraphTile` for each edge that leaves the tile.
+struct TileCache {
+  static constexpr size_t kMaxTiles = 1024;
+
+  const TileSet& tileset;
+  std::unordered_map<uint64_t, baldr::graph_tile_ptr> tiles;
+
+  /// Returns nullptr if the tile doesn't exist in the tileset.
+  baldr::graph_tile_ptr get(baldr::GraphId id) {
+    const auto base = id.tile_base();
+    if (auto it = tiles.find(base); it != tiles.end()) {
+      return it->second;
+    }
+    if (tiles.size() >= kMaxTiles) {
+      tiles.clear();
+    }
+    baldr::graph_tile_ptr tile(tileset.get_graph_tile(base), false);
+    tiles.emplace(base, tile);
+    return tile;
+  }
+};
+
+struct Validator {
+  TileCache cache;
+  std::vector<ValidationError> errors;
+
+  void error(ValidationErrorKind kind, baldr::GraphId tile, baldr::GraphId id, const std::string& message) {
+    errors.push_back(ValidationError{
+      .kind = kind,
+      .tile = tile,
+      .id = id,
+      .message = rust::String(message),
+    });
+  }
+
+  void validate_tile(baldr::GraphId tile_id) {
+    const auto [data, size] = cache.tileset.tiles_.at(tile_id);
+    if (size < sizeof(baldr::GraphTileHeader)) {
+      error(ValidationErrorKind::InvalidTile, tile_id, tile_id, "Tile is smaller than its header");
+      return;
+    }
+    const auto* header = reinterpret_cast<const baldr::GraphTileHeader*>(data);
+    if (header->graphid() != tile_id) {
+      error(ValidationErrorKind::InvalidTile, tile_id, tile_id,
+            "Tile header has " + to_string(header->graphid()) + " graph id");
+      return;
+    }
+    if (header->end_offset() > size) {
+      error(ValidationErrorKind::InvalidTile, tile_id, tile_id,
+            "Tile header end offset " + std::to_string(header->end_offset()) + " exceeds tile size " +
+                std::to_string(size));
+      return;
+    }
+
+    try {
+      validate_nodes(tile_id);
+    } catch (const std::exception& e) {
+      error(ValidationErrorKind::InvalidTile, tile_id, tile_id, e.what());
+    }
+  }
+
+  void validate_nodes(baldr::GraphId tile_id) {
+    const auto tile = cache.get(tile_id);
+    const auto nodes = tile->GetNodes();
+    const auto edges = tile->GetDirectedEdges();
+    const uint32_t transition_count = tile->header()->transitioncount();
+
+    for (uint32_t n = 0; n < nodes.size(); ++n) {
+      const auto& node = nodes[n];
+      const baldr::GraphId node_id(tile_id.tileid(), tile_id.level(), n);
+
+      if (node.transition_index() + node.transition_count() > transition_count) {
+        error(ValidationErrorKind::NodeTransitionRange, tile_id, node_id,
+              "Node transitions [" + std::to_string(node.transition_index()) + ", +" +
+                  std::to_string(node.transition_count()) + ") exceed " + std::to_string(transition_count) +
+                  " transitions in the tile");
+      } else {
+        for (uint32_t i = 0; i < node.transition_count(); ++i) {
+          validate_transition(tile_id, node_id, *tile->transition(node.transition_index() + i));
+        }
+      }
+
+      if (node.edge_index() + node.edge_count() > edges.size()) {
+        error(ValidationErrorKind::NodeEdgeRange, tile_id, node_id,
+              "Node edges [" + std::to_string(node.edge_index()) + ", +" + std::to_string(node.edge_count()) +
+                  ") exceed " + std::to_string(edges.size()) + " edges in the tile");
+        continue;
+      }
+      for (uint32_t i = node.edge_index(); i < node.edge_index() + node.edge_count(); ++i) {
+        validate_edge(tile, node_id, baldr::GraphId(tile_id.tileid(), tile_id.level(), i), edges[i]);
+      }
+    }
+  }
+
+  void validate_edge(const baldr::graph_tile_ptr& tile, baldr::GraphId node_id, baldr::GraphId edge_id,
+                     const baldr::DirectedEdge& de) {
+    const auto tile_id = tile->id();
+    const auto end_node = de.endnode();
+    const auto end_tile = end_node.tile_base() == tile_id ? tile : cache.get(end_node);
+    if (!end_tile || end_node.id() >= end_tile->header()->nodecount()) {
+      error(ValidationErrorKind::MissingEndNode, tile_id, edge_id, "End node " + to_string(end_node) + " is missing");
+      return;
+    }
+
+    const auto* end = end_tile->node(end_node.id());
+    if (de.opp_index() >= end->edge_count()) {
+      error(ValidationErrorKind::MissingOppositeEdge, tile_id, edge_id,
+            "Opposing edge index " + std::to_string(de.opp_index()) + " exceeds " +
+                std::to_string(end->edge_count()) + " edges of the end node " + to_string(end_node));
+      return;
+    }
+
+    const baldr::GraphId opp_id(end_node.tileid(), end_node.level(), end->edge_index() + de.opp_index());
+    const auto* opp = end_tile->directededge(opp_id.id());
+    if (opp->endnode() != node_id) {
+      error(ValidationErrorKind::OppositeEdgeMismatch, tile_id, edge_id,
+            "Opposing edge " + to_string(opp_id) + " ends at " + to_string(opp->endnode()) + " instead of " +
+                to_string(node_id));
+    }
+  }
+
+  void validate_transition(baldr::GraphId tile_id, baldr::GraphId node_id, const baldr::NodeTransition& transition) {
+    const auto target = transition.endnode();
+    const auto target_tile = cache.get(target);
+    if (!target_tile || target.id() >= target_tile->header()->nodecount()) {
+      error(ValidationErrorKind::MissingTransitionNode, tile_id, node_id,
+            "Transition end node " + to_string(target) + " is missing");
+      return;
+    }
+
+    const auto* target_node = target_tile->node(target.id());
+    for (uint32_t i = 0; i < target_node->transition_count(); ++i) {
+      if (target_tile->transition(target_node->transition_index() + i)->endnode() == node_id) {
+        return;
+      }
+    }
+    error(ValidationErrorKind::AsymmetricTransition, tile_id, node_id,
+          "Node " + to_string(target) + " has no transition back");
+  }
+};
+
+constexpr uint32_t kNoNode = std::numeric_limits<uint32_t>::max();
+
+/// Dense numbering of the nodes of all tiles, so per-node data of the whole graph fits into flat arrays.
+struct GlobalNodes {
+  std::vector<baldr::GraphId> tile_ids;
+  /// `node_offsets[i]` is the global index of the first node of the `tile_ids[i]` tile.
+  std::vector<uint64_t> node_offsets;
+  std::unordered_map<uint64_t, size_t> tile_index;
+
+  explicit GlobalNodes(const TileSet& tileset) : tile_ids(sorted_tile_ids(tileset)) {
+    node_offsets.reserve(tile_ids.size() + 1);
+    node_offsets.push_back(0);
+    for (size_t i = 0; i < tile_ids.size(); ++i) {
+      const auto* header = tileset.graph_tile_header(tile_ids[i]);
+      node_offsets.push_back(node_offsets.back() + (header ? header->nodecount() : 0));
+      tile_index.emplace(tile_ids[i], i);
+    }
+    if (node_offsets.back() >= kNoNode) {
+      throw std::runtime_error("Too many nodes in the tileset");
+    }
+  }
+
+  /// Global index of the node or [`kNoNode`] if its tile is not in the tileset.
+  uint32_t index(baldr::GraphId node) const {
+    const auto it = tile_index.find(node.tile_base());
+    return it != tile_index.end() ? static_cast<uint32_t>(node_offsets[it->second] + node.id()) : kNoNode;
+  }
+};
+
+/// Whether the edge can be used for routing with the costing. Shortcuts duplicate regular edges, so are skipped.
+bool traversable(const sif::DynamicCost& costing, const baldr::DirectedEdge& de) {
+  return !de.is_shortcut() && costing.IsAccessible(&de);
+}
+
+/// Iterative Tarjan's algorithm over the graph in CSR form. Returns component id per node and fills the number of
+/// nodes per component.
+std::vector<uint32_t> tarjan(const std::vector<uint64_t>& offsets, const std::vector<uint32_t>& targets,
+                             std::vector<uint32_t>& component_sizes) {
+  const size_t count = offsets.size() - 1;
+  std::vector<uint32_t> index(count, kNoNode);
+  std::vector<uint32_t> lowlink(count);
+  std::vector<uint32_t> components(count, ConnectedComponents::kNoComponent);
+  std::vector<uint32_t> stack;
+  // Explicit call stack of (node, next outgoing link) instead of recursion that would overflow on large graphs
+  std::vector<std::pair<uint32_t, uint64_t>> calls;
+  uint32_t next_index = 0;
+
+  const auto visit = [&](uint32_t node) {
+    index[node] = lowlink[node] = next_index++;
+    stack.push_back(node);
+    calls.emplace_back(node, offsets[node]);
+  };
+
+  for (uint32_t root = 0; root < count; ++root) {
+    if (index[root] != kNoNode) {
+      continue;
+    }
+    visit(root);
+    while (!calls.empty()) {
+      const auto [node, link] = calls.back();
+      if (link < offsets[node + 1]) {
+        ++calls.back().second;
+        const uint32_t target = targets[link];
+        if (index[target] == kNoNode) {
+          visit(target);
+        } else if (components[target] == ConnectedComponents::kNoComponent) {
+          // Visited nodes without a component are exactly the nodes on the stack
+          lowlink[node] = std::min(lowlink[node], index[target]);
+        }
+        continue;
+      }
+
+      calls.pop_back();
+      if (!calls.empty()) {
+        const uint32_t parent = calls.back().first;
+        lowlink[parent] = std::min(lowlink[parent], lowlink[node]);
+      }
+      if (lowlink[node] == index[node]) {
+        const auto component = static_cast<uint32_t>(component_sizes.size());
+        uint32_t size = 0;
+        uint32_t member;
+        do {
+          member = stack.back();
+          stack.pop_back();
+          components[member] = component;
+          ++size;
+        } while (member != node);
+        component_sizes.push_back(size);
+      }
+    }
+  }
+  return components;
+}
+
+/// Backing storage of components built in memory.
+struct OwnedComponents {
+  std::vector<uint64_t> tiles;
+  std::vector<uint32_t> edge_components;
+  std::vector<uint32_t> component_sizes;
+};
+
+/// Header of the components sidecar file, followed by tiles, edge components and component sizes arrays.
+struct ComponentFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t tiles;
+  uint64_t edges;
+  uint64_t components;
+};
+
+constexpr char kComponentFileMagic[8] = { 'V', 'H', 'C', 'O', 'M', 'P', 'N', 'T' };
+constexpr uint32_t kComponentFileVersion = 1;
+
+std::shared_ptr<ConnectedComponents> make_components(std::shared_ptr<const void> storage,
+                                                     std::span<const uint64_t> tiles,
+                                                     std::span<const uint32_t> edge_components,
+                                                     std::span<const uint32_t> component_sizes) {
+  auto components = std::make_shared<ConnectedComponents>();
+  components->storage_ = std::move(storage);
+  components->tiles_ = tiles;
+  components->edge_components_ = edge_components;
+  components->component_sizes_ = component_sizes;
+  uint64_t offset = 0;
+  for (size_t i = 0; i + 1 < tiles.size(); i += 2) {
+    components->edge_ranges_.emplace(tiles[i], std::make_pair(offset, tiles[i + 1]));
+    offset += tiles[i + 1];
+  }
+  if (offset != edge_components.size()) {
+    throw std::runtime_error("Edge components don't match tiles");
+  }
+  return components;
+}
+
+/// Tiles as vertices of a weighted graph, where tiles are connected by edges and transitions between them.
+struct TileGraph {
+  std::vector<baldr::GraphId> tile_ids;
+  std::unordered_map<uint64_t, uint32_t> tile_index;
+  /// Number of directed edges in the tile, at least 1 to give empty tiles some weight.
+  std::vector<uint64_t> weights;
+  /// Tile center as (lon, lat) with longitude scaled to make distances comparable along both axes.
+  std::vector<std::pair<double, double>> centers;
+  /// Sorted (neighbour tile, number of links) pairs per tile.
+  std::vector<std::vector<std::pair<uint32_t, uint32_t>>> neighbours;
+
+  explicit TileGraph(const TileSet& tileset) : tile_ids(sorted_tile_ids(tileset)) {
+    const size_t count = tile_ids.size();
+    weights.resize(count);
+    centers.resize(count);
+    neighbours.resize(count);
+    for (uint32_t t = 0; t < count; ++t) {
+      tile_index.emplace(tile_ids[t], t);
+    }
+
+    parallel_for(count, [&](size_t, size_t t) {
+      const baldr::graph_tile_ptr tile(tileset.get_graph_tile(tile_ids[t]), false);
+      const auto level = tile_ids[t].level();
+      const auto& levels = baldr::TileHierarchy::levels();
+      const auto& tiles = level < levels.size() ? levels[level].tiles : baldr::TileHierarchy::GetTransitLevel().tiles;
+      const double half_size = tiles.TileSize() / 2.0;
+      const auto base_ll = tile->header()->base_ll();
+      const double lat = base_ll.lat() + half_size;
+      centers[t] = { (base_ll.lng() + half_size) * std::cos(lat * std::numbers::pi / 180.0), lat };
+      weights[t] = std::max<uint64_t>(tile->header()->directededgecount(), 1);
+
+      std::unordered_map<uint32_t, uint32_t> links;
+      const auto add_link = [&](baldr::GraphId node) {
+        const auto it = tile_index.find(node.tile_base());
+        if (it != tile_index.end() && it->second != t) {
+          ++links[it->second];
+        }
+      };
+      for (const auto& de : tile->GetDirectedEdges()) {
+        add_link(de.endnode());
+      }
+      for (const auto& node : tile->GetNodes()) {
+        for (uint32_t i = 0; i < node.transition_count(); ++i) {
+          add_link(tile->transition(node.transition_index() + i)->endnode());
+        }
+      }
+      neighbours[t].assign(links.begin(), links.end());
+      std::sort(neighbours[t].begin(), neighbours[t].end());
+    });
+  }
+
+  /// Recursive coordinate bisection: splits tiles along the longer axis of their bounding box at the weighted median,
+  /// proportionally to the number of partitions on each side. Requires at least `count` tiles.
+  void bisect(std::span<uint32_t> tiles, uint32_t first, uint32_t count, std::vector<uint32_t>& partitions) const {
+    if (count == 1 || tiles.size() <= 1) {
+      for (const auto t : tiles) {
+        partitions[t] = first;
+      }
+      return;
+    }
+
+    double min_x = std::numeric_limits<double>::max(), max_x = std::numeric_limits<double>::lowest();
+    double min_y = min_x, max_y = max_x;
+    uint64_t total = 0;
+    for (const auto t : tiles) {
+      min_x = std::min(min_x, centers[t].first);
+      max_x = std::max(max_x, centers[t].first);
+      min_y = std::min(min_y, centers[t].second);
+      max_y = std::max(max_y, centers[t].second);
+      total += weights[t];
+    }
+    const bool by_x = max_x - min_x >= max_y - min_y;
+    std::sort(tiles.begin(), tiles.end(), [&](uint32_t a, uint32_t b) {
+      return by_x ? centers[a].first < centers[b].first : centers[a].second < centers[b].second;
+    });
+
+    const uint32_t left = count / 2;
+    const uint64_t target = total * left / count;
+    uint64_t accumulated = 0;
+    size_t split = 0;
+    while (split < tiles.size() - 1 && accumulated + weights[tiles[split]] / 2 < target) {
+      accumulated += weights[tiles[split++]];
+    }
+    // Each side needs at least as many tiles as partitions, otherwise some partition would end up empty
+    split = std::clamp<size_t>(split, left, tiles.size() - (count - left));
+    bisect(tiles.subspan(0, split), first, left, partitions);
+    bisect(tiles.subspan(split), first + left, count - left, partitions);
+  }
+
+  /// Greedy refinement: moves boundary tiles to the neighbouring partition they have the most links with, as long
+  /// as it reduces the cut and keeps partition weights within `max_weight`.
+  void refine(std::vector<uint32_t>& partitions, uint32_t count, uint64_t max_weight) const {
+    constexpr size_t kPasses = 8;
+
+    std::vector<uint64_t> partition_weights(count);
+    std::vector<uint32_t> partition_tiles(count);
+    for (size_t t = 0; t < tile_ids.size(); ++t) {
+      partition_weights[partitions[t]] += weights[t];
+      ++partition_tiles[partitions[t]];
+    }
+
+    std::unordered_map<uint32_t, uint64_t> links;
+    for (size_t pass = 0; pass < kPasses; ++pass) {
+      size_t moved = 0;
+      for (uint32_t t = 0; t < tile_ids.size(); ++t) {
+        const uint32_t own = partitions[t];
+        links.clear();
+        for (const auto& [neighbour, weight] : neighbours[t]) {
+          links[partitions[neighbour]] += weight;
+        }
+
+        const auto own_it = links.find(own);
+        const uint64_t own_links = own_it != links.end() ? own_it->second : 0;
+        uint32_t best = own;
+        int64_t best_gain = 0;
+        for (const auto& [partition, weight] : links) {
+          const int64_t gain = static_cast<int64_t>(weight) - static_cast<int64_t>(own_links);
+          if (partition != own && gain > best_gain && partition_weights[partition] + weights[t] <= max_weight) {
+            best = partition;
+            best_gain = gain;
+          }
+        }
+        // Never leave a partition empty
+        if (best != own && partition_tiles[own] > 1) {
+          partition_weights[own] -= weights[t];
+          partition_weights[best] += weights[t];
+          --partition_tiles[own];
+          ++partition_tiles[best];
+          partitions[t] = best;
+          ++moved;
+        }
+      }
+      if (moved == 0) {
+        break;
+      }
+    }
+  }
+};
+
+/// Part of a directed edge reached by the expansion: fractions `from..to` of its length, where `time` is the travel
+/// time at `from` and `secs` is the change of the travel time along the whole edge, negative for reverse expansions.
+struct ReachedSpan {
+  baldr::GraphId edge;
+  float time;
+  float secs;
+  float from;
+  float to;
+};
+
+constexpr uint32_t kSecondsPerWeek = 7 * 24 * 60 * 60;
+
+/// Directed edge the point is snapped to.
+struct SnappedEdge {
+  baldr::GraphId edge;
+  float percent_along;
+};
+
+/// Both directed edges of the closest road within `radius` meters that are accessible with the costing.
+std::vector<SnappedEdge> snap(const EdgeIndex& index, TileCache& cache, const sif::DynamicCost& costing, double lat,
+                              double lon, float radius) {
+  std::vector<SnappedEdge> snapped;
+  float closest = std::numeric_limits<float>::max();
+  for (const auto& candidate : index.nearest(lat, lon, radius, 4)) {
+    if (candidate.distance > closest + 1.0f) {
+      break;
+    }
+    const auto tile = cache.get(candidate.edge);
+    if (tile && traversable(costing, *tile->directededge(candidate.edge))) {
+      snapped.push_back(SnappedEdge{ .edge = candidate.edge, .percent_along = candidate.percent_along });
+      closest = std::min(closest, candidate.distance);
+    }
+  }
+  return snapped;
+}
+
+/// Multi-source Dijkstra over graph nodes that keeps only the best travel time per node. All sources are seeded at
+/// once, so the time of each node is the time from the nearest source.
+///
+/// Reverse expansions follow edges against their direction and give the time from each node to the nearest source
+/// instead. If the arrival time is set, edge speeds are taken from the predicted traffic at the time the edge is
+/// traversed, counting back from the arrival.
+struct Expansion {
+  TileCache cache;
+  const sif::DynamicCost& costing;
+  float max_time;
+  bool reverse = false;
+  /// Arrival time as seconds from the start of the week (Sunday midnight) for reverse time-dependent expansions.
+  std::optional<uint32_t> arrival;
+  std::unordered_map<uint64_t, float> times;
+  using QueueItem = std::pair<float, uint64_t>;
+  std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> queue;
+  std::vector<ReachedSpan> spans;
+  /// Number of spans on the edges the expansion was seeded with, which come first in `spans`.
+  size_t seed_spans = 0;
+
+  /// Time to traverse the edge, entered or left `time` seconds away from the sources.
+  float edge_secs(const baldr::DirectedEdge& de, const baldr::graph_tile_ptr& tile, float time) const {
+    auto time_info = baldr::TimeInfo::invalid();
+    if (arrival) {
+      time_info.valid = 1;
+      time_info.second_of_week =
+          (*arrival + kSecondsPerWeek - static_cast<uint32_t>(time) % kSecondsPerWeek) % kSecondsPerWeek;
+      // Far enough from now for live traffic to be ignored in favour of the predicted speeds
+      time_info.seconds_from_now = kSecondsPerWeek;
+    }
+    uint8_t flow_sources;
+    return costing.EdgeCost(&de, tile, time_info, flow_sources).secs;
+  }
+
+  void reach(baldr::GraphId node, float time) {
+    if (time > max_time) {
+      return;
+    }
+    const auto [it, inserted] = times.try_emplace(node.value, time);
+    if (!inserted) {
+      if (it->second <= time) {
+        return;
+      }
+      it->second = time;
+    }
+    queue.emplace(time, node.value);
+  }
+
+  /// Reached part of the edge, clipped by `max_time`. `time` is at `along` and grows towards the edge end in forward
+  /// expansions, and towards the edge start in reverse ones.
+  void reach_span(baldr::GraphId edge, float time, float secs, float along) {
+    const float remaining = secs > 0.0f ? (max_time - time) / secs : 1.0f;
+    if (!reverse) {
+      const float to = std::min(1.0f, along + remaining);
+      if (to > along) {
+        spans.push_back(ReachedSpan{ .edge = edge, .time = time, .secs = secs, .from = along, .to = to });
+      }
+    } else {
+      const float from = std::max(0.0f, along - remaining);
+      if (along > from) {
+        const float start_time = time + (along - from) * secs;
+        spans.push_back(ReachedSpan{ .edge = edge, .time = start_time, .secs = -secs, .from = from, .to = along });
+      }
+    }
+  }
+
+  /// Start node of the directed edge, found via its opposing edge.
+  std::optional<baldr::GraphId> start_node(const baldr::DirectedEdge& de) {
+    const auto end_tile = cache.get(de.endnode());
+    if (!end_tile || de.endnode().id() >= end_tile->header()->nodecount()) {
+      return std::nullopt;
+    }
+    const auto* end_node = end_tile->node(de.endnode());
+    return end_tile->directededge(end_node->edge_index() + de.opp_index())->endnode();
+  }
+
+  /// Seeds the search with a source snapped to the edge.
+  void seed(const SnappedEdge& source) {
+    const auto tile = cache.get(source.edge);
+    const auto& de = *tile->directededge(source.edge);
+    const float secs = edge_secs(de, tile, 0.0f);
+    reach_span(source.edge, 0.0f, secs, source.percent_along);
+    seed_spans = spans.size();
+    if (!reverse) {
+      reach(de.endnode(), secs * (1.0f - source.percent_along));
+    } else if (const auto start = start_node(de)) {
+      reach(*start, secs * source.percent_along);
+    }
+  }
+
+  void run() {
+    while (!queue.empty()) {
+      const auto [time, id] = queue.top();
+      queue.pop();
+      if (times[id] < time) {
+        continue;
+      }
+      const baldr::GraphId node_id(id);
+      const auto tile = cache.get(node_id);
+      if (!tile || node_id.id() >= tile->header()->nodecount()) {
+        continue;
+      }
+      const auto* node = tile->node(node_id);
+      if (!costing.Allowed(node)) {
+        continue;
+      }
+      for (uint32_t i = 0; i < node->edge_count(); ++i) {
+        const auto& de = *tile->directededge(node->edge_index() + i);
+        if (!reverse) {
+          if (traversable(costing, de)) {
+            const float secs = edge_secs(de, tile, time);
+            reach_span(baldr::GraphId(node_id.tileid(), node_id.level(), node->edge_index() + i), time, secs, 0.0f);
+            reach(de.endnode(), time + secs);
+          }
+          continue;
+        }
+
+        // Incoming edge is the opposing edge of the outgoing one
+        if (de.is_shortcut()) {
+          continue;
+        }
+        const auto end_tile = cache.get(de.endnode());
+        if (!end_tile || de.endnode().id() >= end_tile->header()->nodecount()) {
+          continue;
+        }
+        const auto* end_node = end_tile->node(de.endnode());
+        const uint32_t opp_index = end_node->edge_index() + de.opp_index();
+        const auto& opp = *end_tile->directededge(opp_index);
+        if (costing.Allowed(end_node) && traversable(costing, opp)) {
+          const float secs = edge_secs(opp, end_tile, time);
+          reach_span(baldr::GraphId(de.endnode().tileid(), de.endnode().level(), opp_index), time, secs, 1.0f);
+          reach(de.endnode(), time + secs);
+        }
+      }
+      // Transitions connect the same intersection on different hierarchy levels, so they are free
+      for (uint32_t i = 0; i < node->transition_count(); ++i) {
+        reach(tile->transition(node->transition_index() + i)->endnode(), time);
+      }
+    }
+  }
+
+  /// Time from the point snapped to the edge to the sources of a finished reverse expansion, or infinity. Points
+  /// upstream of a source on the same edge reach it directly along the edge, without going through the end node.
+  float time_to_sources(const SnappedEdge& point) {
+    float best = std::numeric_limits<float>::infinity();
+    for (size_t i = 0; i < seed_spans; ++i) {
+      const auto& span = spans[i];
+      if (span.edge == point.edge && span.from <= point.percent_along && point.percent_along <= span.to) {
+        best = std::min(best, std::max(0.0f, span.time + (point.percent_along - span.from) * span.secs));
+      }
+    }
+
+    const auto tile = cache.get(point.edge);
+    const auto& de = *tile->directededge(point.edge);
+    const auto it = times.find(de.endnode().value);
+    if (it == times.end()) {
+      return best;
+    }
+    return std::min(best, it->second + edge_secs(de, tile, it->second) * (1.0f - point.percent_along));
+  }
+};
+
+/// Travel time sample at a point of the reached edge.
+struct TimeSample {
+  double lat;
+  double lon;
+  float time;
+};
+
+/// Samples the reached part of the edge shape every `step` meters, including both ends of the span.
+void sample_span(TileCache& cache, const ReachedSpan& span, double step, std::vector<TimeSample>& samples) {
+  const auto tile = cache.get(span.edge);
+  const auto* de = tile->directededge(span.edge);
+  auto shape = tile->edgeinfo(de).shape();
+  if (!de->forward()) {
+    std::reverse(shape.begin(), shape.end());
+  }
+  if (shape.empty()) {
+    return;
+  }
+
+  double length = 0.0;
+  for (size_t i = 1; i < shape.size(); ++i) {
+    length += shape[i - 1].Distance(shape[i]);
+  }
+  const double from = span.from * length;
+  const double to = span.to * length;
+  const auto time_at = [&](double along) {
+    return length > 0.0 ? span.time + static_cast<float>((along - from) / length) * span.secs : span.time;
+  };
+
+  double along = 0.0;
+  double next = from;
+  for (size_t i = 1; i < shape.size() && next <= to; ++i) {
+    const double segment = shape[i - 1].Distance(shape[i]);
+    while (next <= to && next <= along + segment) {
+      const double t = segment > 0.0 ? (next - along) / segment : 0.0;
+      samples.push_back(TimeSample{
+        .lat = shape[i - 1].lat() + (shape[i].lat() - shape[i - 1].lat()) * t,
+        .lon = shape[i - 1].lng() + (shape[i].lng() - shape[i - 1].lng()) * t,
+        .time = time_at(next),
+      });
+      next = next < to ? std::min(next + step, to) : to + 1.0;
+    }
+    along += segment;
+  }
+}
+
+/// Rasterizes the reached spans into a grid of the minimal travel time per cell. Spans are sampled and rasterized
+/// in parallel into per-worker grids, which are then merged by taking the minimum, so the result doesn't depend on
+/// the scheduling.
+TimeRaster rasterize(const TileSet& tileset, const std::vector<ReachedSpan>& spans, double cell_size) {
+  constexpr double kMetersPerDegree = 111'320.0;
+  constexpr uint64_t kMaxCells = uint64_t(1) << 28;
+  const size_t workers = worker_count();
+  const double step = cell_size * kMetersPerDegree / 2.0;
+
+  std::vector<std::vector<TimeSample>> samples(workers);
+  std::vector<TileCache> caches(workers, TileCache{ .tileset = tileset });
+  parallel_for(spans.size(),
+               [&](size_t worker, size_t i) { sample_span(caches[worker], spans[i], step, samples[worker]); });
+
+  double south = std::numeric_limits<double>::max();
+  double west = std::numeric_limits<double>::max();
+  double north = std::numeric_limits<double>::lowest();
+  double east = std::numeric_limits<double>::lowest();
+  for (const auto& worker_samples : samples) {
+    for (const auto& sample : worker_samples) {
+      south = std::min(south, sample.lat);
+      west = std::min(west, sample.lon);
+      north = std::max(north, sample.lat);
+      east = std::max(east, sample.lon);
+    }
+  }
+  TimeRaster raster{ .south = 0.0, .west = 0.0, .cell_size = cell_size, .rows = 0, .columns = 0 };
+  if (south > north) {
+    return raster;
+  }
+  // Snap the origin to the grid, so rasters of the same area are aligned
+  raster.south = std::floor(south / cell_size) * cell_size;
+  raster.west = std::floor(west / cell_size) * cell_size;
+  const auto rows = static_cast<uint64_t>((north - raster.south) / cell_size) + 1;
+  const auto columns = static_cast<uint64_t>((east - raster.west) / cell_size) + 1;
+  if (rows * columns > kMaxCells) {
+    throw std::runtime_error("Raster of " + std::to_string(rows) + "x" + std::to_string(columns) +
+                             " cells is too large, use a bigger cell size");
+  }
+  raster.rows = static_cast<uint32_t>(rows);
+  raster.columns = static_cast<uint32_t>(columns);
+
+  constexpr float kUnreached = std::numeric_limits<float>::infinity();
+  std::vector<std::vector<float>> grids(workers);
+  parallel_for(workers, [&](size_t, size_t w) {
+    if (samples[w].empty()) {
+      return;
+    }
+    grids[w].assign(rows * columns, kUnreached);
+    for (const auto& sample : samples[w]) {
+      const auto row = std::min(rows - 1, static_cast<uint64_t>((sample.lat - raster.south) / cell_size));
+      const auto column = std::min(columns - 1, static_cast<uint64_t>((sample.lon - raster.west) / cell_size));
+      auto& cell = grids[w][row * columns + column];
+      cell = std::min(cell, sample.time);
+    }
+    samples[w] = {};
+  });
+
+  raster.times.reserve(rows * columns);
+  for (size_t i = 0; i < rows * columns; ++i) {
+    raster.times.push_back(kUnreached);
+  }
+  const size_t chunk = std::max<size_t>(columns, 1 << 16);
+  parallel_for((rows * columns + chunk - 1) / chunk, [&](size_t, size_t c) {
+    const size_t end = std::min<size_t>(rows * columns, (c + 1) * chunk);
+    for (const auto& grid : grids) {
+      for (size_t i = c * chunk; i < end && !grid.empty(); ++i) {
+        raster.times[i] = std::min(raster.times[i], grid[i]);
+      }
+    }
+  });
+  return raster;
+}
+
+void check_arrive_by(rust::Slice<const double> points, uint32_t second_of_week, float max_time) {
+  if (points.size() % 2 != 0) {
+    throw std::runtime_error("Points should be interleaved latitude and longitude pairs");
+  }
+  if (second_of_week >= kSecondsPerWeek) {
+    throw std::runtime_error("Arrival time should be less than a week in seconds");
+  }
+  if (!(max_time > 0.0f)) {
+    throw std::runtime_error("Max time must be positive");
+  }
+}
+
+/// Reverse time-dependent expansion from the target, arriving at `second_of_week`.
+Expansion arrive_by(const EdgeIndex& index, const sif::DynamicCost& costing, double lat, double lon,
+                    uint32_t second_of_week, float snap_radius, float max_time) {
+  Expansion expansion{
+    .cache = TileCache{ .tileset = *index.tileset_ },
+    .costing = costing,
+    .max_time = max_time,
+    .reverse = true,
+    .arrival = second_of_week,
+  };
+  for (const auto& target : snap(index, expansion.cache, costing, lat, lon, snap_radius)) {
+    expansion.seed(target);
+  }
+  expansion.run();
+  return expansion;
+}
+
+}  // namespace
+
+rust::Vec<ValidationError> validate_graph(const TileSet& tileset, size_t max_errors) {
+  const auto tile_ids = sorted_tile_ids(tileset);
+
+  std::atomic<size_t> error_count = 0;
+  std::vector<Validator> validators;
+  for (size_t i = 0; i < worker_count(); ++i) {
+    validators.push_back(Validator{ .cache = TileCache{ .tileset = tileset } });
+  }
+  parallel_for(tile_ids.size(), [&](size_t worker, size_t i) {
+    if (error_count < max_errors) {
+      auto& validator = validators[worker];
+      const size_t before = validator.errors.size();
+      validator.validate_tile(tile_ids[i]);
+      error_count += validator.errors.size() - before;
+    }
+  });
+
+  std::vector<ValidationError> errors;
+  for (auto& validator : validators) {
+    std::move(validator.errors.begin(), validator.errors.end(), std::back_inserter(errors));
+  }
+  std::stable_sort(errors.begin(), errors.end(), [](const ValidationError& a, const ValidationError& b) {
+    return std::tie(a.tile.value, a.id.value) < std::tie(b.tile.value, b.id.value);
+  });
+  errors.erase(errors.begin() + std::min(errors.size(), max_errors), errors.end());
+
+  rust::Vec<ValidationError> result;
+  result.reserve(errors.size());
+  for (auto& error : errors) {
+    result.push_back(std::move(error));
+  }
+  return result;
+}
+
+uint32_t ConnectedComponents::component(baldr::GraphId edge) const {
+  const auto it = edge_ranges_.find(edge.tile_base());
+  if (it == edge_ranges_.end() || edge.id() >= it->second.second) {
+    return kNoComponent;
+  }
+  return edge_components_[it->second.first + edge.id()];
+}
+
+uint32_t ConnectedComponents::component_size(uint32_t component) const {
+  return component < component_sizes_.size() ? component_sizes_[component] : 0;
+}
+
+void ConnectedComponents::save(rust::Slice<const uint8_t> path) const {
+  ComponentFileHeader header{};
+  std::memcpy(header.magic, kComponentFileMagic, sizeof(header.magic));
+  header.version = kComponentFileVersion;
+  header.tiles = tiles_.size() / 2;
+  header.edges = edge_components_.size();
+  header.components = component_sizes_.size();
+
+  const std::string file(reinterpret_cast<const char*>(path.data()), path.size());
+  std::ofstream out(file, std::ios::binary | std::ios::trunc);
+  const auto write = [&out](const auto& data) {
+    out.write(reinterpret_cast<const char*>(data.data()), data.size_bytes());
+  };
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  write(tiles_);
+  write(edge_components_);
+  write(component_sizes_);
+  if (!out.flush()) {
+    throw std::runtime_error("Failed to write components to " + file);
+  }
+}
+
+std::shared_ptr<ConnectedComponents> strongly_connected_components(
+    const TileSet& tileset, const std::shared_ptr<sif::DynamicCost>& costing) {
+  const GlobalNodes nodes(tileset);
+  const size_t tile_count = nodes.tile_ids.size();
+
+  // Outgoing links of each tile nodes: accessible edges and transitions to the same node on other levels
+  struct TileAdjacency {
+    std::vector<uint32_t> degrees;
+    std::vector<uint32_t> targets;
+  };
+  std::vector<TileAdjacency> adjacency(tile_count);
+  parallel_for(tile_count, [&](size_t, size_t t) {
+    const baldr::graph_tile_ptr tile(tileset.get_graph_tile(nodes.tile_ids[t]), false);
+    const auto tile_nodes = tile->GetNodes();
+    const auto edges = tile->GetDirectedEdges();
+    auto& [degrees, targets] = adjacency[t];
+    degrees.resize(tile_nodes.size());
+    for (uint32_t n = 0; n < tile_nodes.size(); ++n) {
+      const auto& node = tile_nodes[n];
+      const size_t before = targets.size();
+      if (costing->Allowed(&node)) {
+        for (uint32_t e = node.edge_index(); e < node.edge_index() + node.edge_count(); ++e) {
+          const auto target = nodes.index(edges[e].endnode());
+          if (target != kNoNode && traversable(*costing, edges[e])) {
+            targets.push_back(target);
+          }
+        }
+        for (uint32_t i = 0; i < node.transition_count(); ++i) {
+          if (const auto target = nodes.index(tile->transition(node.transition_index() + i)->endnode());
+              target != kNoNode) {
+            targets.push_back(target);
+          }
+        }
+      }
+      degrees[n] = static_cast<uint32_t>(targets.size() - before);
+    }
+  });
+
+  std::vector<uint64_t> offsets;
+  offsets.reserve(nodes.node_offsets.back() + 1);
+  offsets.push_back(0);
+  std::vector<uint32_t> targets;
+  for (auto& tile : adjacency) {
+    for (const auto degree : tile.degrees) {
+      offsets.push_back(offsets.back() + degree);
+    }
+    targets.insert(targets.end(), tile.targets.begin(), tile.targets.end());
+    tile = {};
+  }
+
+  auto owned = std::make_shared<OwnedComponents>();
+  const auto node_components = tarjan(offsets, targets, owned->component_sizes);
+  offsets = {};
+  targets = {};
+
+  // Edges are labelled only if both ends are in the same component, otherwise they lead out of it for good
+  std::vector<uint64_t> edge_offsets{ 0 };
+  for (const auto tile_id : nodes.tile_ids) {
+    const auto* header = tileset.graph_tile_header(tile_id);
+    owned->tiles.insert(owned->tiles.end(), { tile_id.value, header->directededgecount() });
+    edge_offsets.push_back(edge_offsets.back() + header->directededgecount());
+  }
+  owned->edge_components.assign(edge_offsets.back(), ConnectedComponents::kNoComponent);
+  parallel_for(tile_count, [&](size_t, size_t t) {
+    const baldr::graph_tile_ptr tile(tileset.get_graph_tile(nodes.tile_ids[t]), false);
+    const auto tile_nodes = tile->GetNodes();
+    const auto edges = tile->GetDirectedEdges();
+    for (uint32_t n = 0; n < tile_nodes.size(); ++n) {
+      const auto& node = tile_nodes[n];
+      if (!costing->Allowed(&node)) {
+        continue;
+      }
+      const uint32_t component = node_components[nodes.node_offsets[t] + n];
+      for (uint32_t e = node.edge_index(); e < node.edge_index() + node.edge_count(); ++e) {
+        const auto end = nodes.index(edges[e].endnode());
+        if (end != kNoNode && node_components[end] == component && traversable(*costing, edges[e])) {
+          owned->edge_components[edge_offsets[t] + e] = component;
+        }
+      }
+    }
+  });
+
+  return make_components(owned, owned->tiles, owned->edge_components, owned->component_sizes);
+}
+
+std::shared_ptr<ConnectedComponents> load_components(const TileSet& tileset, rust::Slice<const uint8_t> path) {
+  const std::string file(reinterpret_cast<const char*>(path.data()), path.size());
+  auto [storage, size] = map_file(path);
+  ComponentFileHeader header{};
+  if (size >= sizeof(header)) {
+    std::memcpy(&header, storage.get(), sizeof(header));
+  }
+  // Counts larger than the file itself would overflow the expected size below
+  if (header.tiles >= size / (2 * sizeof(uint64_t)) || header.edges >= size / sizeof(uint32_t) ||
+      header.components >= size / sizeof(uint32_t)) {
+    throw std::runtime_error("Invalid components file " + file);
+  }
+  const size_t expected_size = sizeof(header) + header.tiles * 2 * sizeof(uint64_t) +
+                               (header.edges + header.components) * sizeof(uint32_t);
+  if (std::memcmp(header.magic, kComponentFileMagic, sizeof(header.magic)) != 0 ||
+      header.version != kComponentFileVersion || expected_size != size) {
+    throw std::runtime_error("Invalid components file " + file);
+  }
+
+  const auto* bytes = static_cast<const std::byte*>(storage.get()) + sizeof(header);
+  const std::span tiles(reinterpret_cast<const uint64_t*>(bytes), header.tiles * 2);
+  bytes += tiles.size_bytes();
+  const std::span edge_components(reinterpret_cast<const uint32_t*>(bytes), header.edges);
+  bytes += edge_components.size_bytes();
+  const std::span component_sizes(reinterpret_cast<const uint32_t*>(bytes), header.components);
+
+  // Components are only meaningful for the exact same tiles
+  bool matches = header.tiles == tileset.tiles_.size();
+  for (size_t i = 0; matches && i < tiles.size(); i += 2) {
+    const auto* tile_header = tileset.graph_tile_header(baldr::GraphId(tiles[i]));
+    matches = tile_header && tile_header->directededgecount() == tiles[i + 1];
+  }
+  if (!matches) {
+    throw std::runtime_error("Components file " + file + " was built for another tileset");
+  }
+
+  return make_components(std::move(storage), tiles, edge_components, component_sizes);
+}
+
+Partitioning partition_graph(const TileSet& tileset, uint32_t partitions, float imbalance) {
+  if (partitions == 0) {
+    throw std::runtime_error("Number of partitions must be positive");
+  }
+  if (!(imbalance >= 0.0f)) {
+    throw std::runtime_error("Imbalance must be non-negative");
+  }
+
+  const TileGraph graph(tileset);
+  const size_t count = graph.tile_ids.size();
+  if (partitions > count) {
+    throw std::runtime_error("Number of partitions must not exceed the number of tiles");
+  }
+  std::vector<uint32_t> tile_partitions(count);
+  std::vector<uint32_t> tiles(count);
+  std::iota(tiles.begin(), tiles.end(), 0);
+  graph.bisect(tiles, 0, partitions, tile_partitions);
+
+  uint64_t total = 0;
+  for (const auto weight : graph.weights) {
+    total += weight;
+  }
+  const auto max_weight = static_cast<uint64_t>(static_cast<double>(total) / partitions * (1.0 + imbalance));
+  graph.refine(tile_partitions, partitions, max_weight);
+
+  // Boundary edges and transitions are collected per tile in parallel and concatenated in the tile order
+  std::vector<std::vector<BoundaryEdge>> boundaries(count);
+  std::vector<std::vector<BoundaryTransition>> boundary_transitions(count);
+  parallel_for(count, [&](size_t, size_t t) {
+    const baldr::graph_tile_ptr tile(tileset.get_graph_tile(graph.tile_ids[t]), false);
+    const auto target_partition = [&](baldr::GraphId node) -> std::optional<uint32_t> {
+      const auto it = graph.tile_index.find(node.tile_base());
+      if (it == graph.tile_index.end() || tile_partitions[it->second] == tile_partitions[t]) {
+        return std::nullopt;
+      }
+      return tile_partitions[it->second];
+    };
+
+    const auto edges = tile->GetDirectedEdges();
+    for (uint32_t e = 0; e < edges.size(); ++e) {
+      if (const auto target = target_partition(edges[e].endnode())) {
+        boundaries[t].push_back(BoundaryEdge{
+          .edge = baldr::GraphId(graph.tile_ids[t].tileid(), graph.tile_ids[t].level(), e),
+          .partition = tile_partitions[t],
+          .target_partition = *target,
+        });
+      }
+    }
+    const auto nodes = tile->GetNodes();
+    for (uint32_t n = 0; n < nodes.size(); ++n) {
+      for (uint32_t i = 0; i < nodes[n].transition_count(); ++i) {
+        const auto end_node = tile->transition(nodes[n].transition_index() + i)->endnode();
+        if (const auto target = target_partition(end_node)) {
+          boundary_transitions[t].push_back(BoundaryTransition{
+            .node = baldr::GraphId(graph.tile_ids[t].tileid(), graph.tile_ids[t].level(), n),
+            .end_node = end_node,
+            .partition = tile_partitions[t],
+            .target_partition = *target,
+          });
+        }
+      }
+    }
+  });
+
+  Partitioning result;
+  result.tiles.reserve(count);
+  result.partitions.reserve(count);
+  for (size_t t = 0; t < count; ++t) {
+    result.tiles.push_back(graph.tile_ids[t]);
+    result.partitions.push_back(tile_partitions[t]);
+    for (const auto& boundary : boundaries[t]) {
+      result.boundary_edges.push_back(boundary);
+    }
+    for (const auto& boundary : boundary_transitions[t]) {
+      result.boundary_transitions.push_back(boundary);
+    }
+  }
+  return result;
+}
+
+TimeRaster time_raster(const EdgeIndex& index, const std::shared_ptr<sif::DynamicCost>& costing,
+                       rust::Slice<const double> origins, float snap_radius, float max_time, double cell_size) {
+  if (origins.size() % 2 != 0) {
+    throw std::runtime_error("Origins should be interleaved latitude and longitude pairs");
+  }
+  if (!(max_time > 0.0f) || !(cell_size > 0.0)) {
+    throw std::runtime_error("Max time and cell size must be positive");
+  }
+
+  Expansion expansion{ .cache = TileCache{ .tileset = *index.tileset_ }, .costing = *costing, .max_time = max_time };
+  for (size_t i = 0; i < origins.size(); i += 2) {
+    // Both directions of the closest road are seeded, as the source can start moving either way
+    for (const auto& source : snap(index, expansion.cache, *costing, origins[i], origins[i + 1], snap_radius)) {
+      expansion.seed(source);
+    }
+  }
+  expansion.run();
+  return rasterize(*index.tileset_, expansion.spans, cell_size);
+}
+
+rust::Vec<TimeRaster> arrive_by_rasters(const EdgeIndex& index, const std::shared_ptr<sif::DynamicCost>& costing,
+                                        rust::Slice<const double> targets, uint32_t second_of_week,
+                                        float snap_radius, float max_time, double cell_size) {
+  check_arrive_by(targets, second_of_week, max_time);
+  if (!(cell_size > 0.0)) {
+    throw std::runtime_error("Cell size must be positive");
+  }
+
+  // Targets are independent, so each is expanded on its own core. Rasterization is parallel by itself.
+  const size_t count = targets.size() / 2;
+  std::vector<std::vector<ReachedSpan>> spans(count);
+  parallel_for(count, [&](size_t, size_t t) {
+    spans[t] = arrive_by(index, *costing, targets[2 * t], targets[2 * t + 1], second_of_week, snap_radius, max_time)
+                   .spans;
+  });
+
+  rust::Vec<TimeRaster> rasters;
+  rasters.reserve(count);
+  for (auto& target_spans : spans) {
+    rasters.push_back(rasterize(*index.tileset_, target_spans, cell_size));
+    target_spans = {};
+  }
+  return rasters;
+}
+
+rust::Vec<float> arrive_by_table(const EdgeIndex& index, const std::shared_ptr<sif::DynamicCost>& costing,
+                                 rust::Slice<const double> sources, rust::Slice<const double> targets,
+                                 uint32_t second_of_week, float snap_radius, float max_time) {
+  check_arrive_by(sources, second_of_week, max_time);
+  check_arrive_by(targets, second_of_week, max_time);
+
+  const size_t source_count = sources.size() / 2;
+  const size_t target_count = targets.size() / 2;
+  TileCache cache{ .tileset = *index.tileset_ };
+  std::vector<std::vector<SnappedEdge>> snapped_sources(source_count);
+  for (size_t s = 0; s < source_count; ++s) {
+    snapped_sources[s] = snap(index, cache, *costing, sources[2 * s], sources[2 * s + 1], snap_radius);
+  }
+
+  // Target columns are filled in parallel, each by a single reverse expansion
+  std::vector<float> table(source_count * target_count, std::numeric_limits<float>::infinity());
+  parallel_for(target_count, [&](size_t, size_t t) {
+    auto expansion =
+        arrive_by(index, *costing, targets[2 * t], targets[2 * t + 1], second_of_week, snap_radius, max_time);
+    for (size_t s = 0; s < source_count; ++s) {
+      for (const auto& source : snapped_sources[s]) {
+        auto& time = table[s * target_count + t];
+        time = std::min(time, expansion.time_to_sources(source));
+      }
+      if (table[s * target_count + t] > max_time) {
+        table[s * target_count + t] = std::numeric_limits<float>::infinity();
+      }
+    }
+  });
+
+  rust::Vec<float> result;
+  result.reserve(table.size());
+  for (const auto time : table) {
+    result.push_back(time);
+  }
+  return result;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "costing.hpp"
+#include "edge_index.hpp"
+#include "libvalhalla.hpp"
+
+#include <limits>
+#include <span>
+
+// Forward Declarations for shared types, defined in graph_tools.rs
+struct ValidationError;
+struct Partitioning;
+struct TimeRaster;
+
+/// Checks integrity of all tiles in the tileset in parallel: tile headers, node edge and transition ranges, end
+/// nodes and opposing edges of directed edges and symmetry of node transitions between hierarchy levels.
+/// Stops after finding `max_errors` errors. Errors are sorted by tile.
+rust::Vec<ValidationError> validate_graph(const TileSet& tileset, size_t max_errors);
+
+/// Strongly connected components of the graph accessible with some costing, labelled per directed edge.
+/// Built by [`strongly_connected_components()`] or memory-mapped from a sidecar file by [`load_components()`].
+struct ConnectedComponents {
+  static constexpr uint32_t kNoComponent = std::numeric_limits<uint32_t>::max();
+
+  /// Owns the memory behind the spans below: either in-memory arrays or a memory-mapped sidecar file.
+  std::shared_ptr<const void> storage_;
+  /// Tile id and directed edge count pairs for all tiles, sorted by tile id.
+  std::span<const uint64_t> tiles_;
+  std::span<const uint32_t> edge_components_;
+  /// Number of nodes per component.
+  std::span<const uint32_t> component_sizes_;
+  /// Index of the first edge of the tile in `edge_components_` and the number of tile edges, by tile id.
+  std::unordered_map<uint64_t, std::pair<uint64_t, uint64_t>> edge_ranges_;
+
+  /// Component of the edge or [`kNoComponent`] if the edge is not accessible or leads to another component.
+  uint32_t component(valhalla::baldr::GraphId edge) const;
+  uint32_t component_size(uint32_t component) const;
+  size_t component_count() const { return component_sizes_.size(); }
+
+  void save(rust::Slice<const uint8_t> path) const;
+};
+
+/// Labels strongly connected components of the graph accessible with the given costing on all hierarchy levels.
+/// Adjacency is collected from tiles in parallel, while the components are found by the iterative Tarjan algorithm.
+std::shared_ptr<ConnectedComponents> strongly_connected_components(
+    const TileSet& tileset, const std::shared_ptr<valhalla::sif::DynamicCost>& costing);
+
+/// Memory-maps components previously saved by [`ConnectedComponents::save()`] for the same tileset.
+std::shared_ptr<ConnectedComponents> load_components(const TileSet& tileset, rust::Slice<const uint8_t> path);
+
+/// Splits tiles of all hierarchy levels into `partitions` geographically compact groups of similar edge counts,
+/// minimizing the number of edges between them. `imbalance` is the allowed excess of the partition edge count over
+/// the average, e.g. `0.1` for 10%.
+Partitioning partition_graph(const TileSet& tileset, uint32_t partitions, float imbalance);
+
+/// Travel times from the nearest of many origins, computed by a single multi-source expansion over the graph. Each
+/// origin, given as interleaved latitude and longitude, is snapped to the closest accessible road within
+/// `snap_radius` meters. Reached edges up to `max_time` seconds are rasterized into a grid of `cell_size` degrees
+/// with the minimal time per cell.
+TimeRaster time_raster(const EdgeIndex& index, const std::shared_ptr<valhalla::sif::DynamicCost>& costing,
+                       rust::Slice<const double> origins, float snap_radius, float max_time, double cell_size);
+
+/// Arrive-by isochrones of the targets, given as interleaved latitude and longitude: travel times to each target
+/// from the area it can be reached from within `max_time` seconds, arriving at `second_of_week` (from Sunday
+/// midnight) with predicted traffic speeds. Targets are expanded in parallel, one raster per target.
+rust::Vec<TimeRaster> arrive_by_rasters(const EdgeIndex& index,
+                                        const std::shared_ptr<valhalla::sif::DynamicCost>& costing,
+                                        rust::Slice<const double> targets, uint32_t second_of_week, float snap_radius,
+                                        float max_time, double cell_size);
+
+/// Travel times from each source to each target, arriving at `second_of_week` with predicted traffic speeds, in
+/// row-major sources by targets order. Pairs that are not reachable within `max_time` seconds are set to infinity.
+rust::Vec<float> arrive_by_table(const EdgeIndex& index, const std::shared_ptr<valhalla::sif::DynamicCost>& costing,
+                                 rust::Slice<const double> sources, rust::Slice<const double> targets,
+                                 uint32_t second_of_week, float snap_radius, float max_time);
@@ -0,0 +1,417 @@
+//! Native tools that process the whole tileset at once, using all available cores.
+
+use std::{fmt, os::unix::ffi::OsStrExt, path::Path};
+
+#[cfg(feature = "proto")]
+use crate::{CostingModel, EdgeIndex};
+use crate::{Error, GraphId, GraphReader, LatLon};
+
+pub use ffi::{
+    BoundaryEdge, BoundaryTransition, Partitioning, TimeRaster, ValidationError,
+    ValidationErrorKind,
+};
+
+#[cxx::bridge]
+mod ffi {
+    /// Kind of the integrity problem found by [`validate`].
+    #[derive(Clone, Copy, Debug, PartialEq, Eq, Hash)]
+    enum ValidationErrorKind {
+        /// Tile header is malformed or doesn't match the tile, or the tile can't be loaded.
+        InvalidTile,
+        /// Node references directed edges outside of the tile.
+        NodeEdgeRange,
+        /// Node references transitions outside of the tile.
+        NodeTransitionRange,
+        /// End node of a directed edge doesn't exist.
+        MissingEndNode,
+        /// Opposing edge index of a directed edge is out of the end node edges.
+        MissingOppositeEdge,
+        /// Opposing edge doesn't lead back to the start node of the directed edge.
+        OppositeEdgeMismatch,
+        /// Node transition leads to a node that doesn't exist.
+        MissingTransitionNode,
+        /// Node on another hierarchy level has no transition back to the node.
+        AsymmetricTransition,
+    }
+
+    /// Integrity problem found by [`validate`].
+    #[derive(Clone, Debug)]
+    struct ValidationError {
+        kind: ValidationErrorKind,
+        /// Tile with the problem.
+        tile: GraphId,
+        /// Tile, node or directed edge with the problem, depending on the `kind`.
+        id: GraphId,
+        /// Human-readable details.
+        message: String,
+    }
+
+    /// Directed edge that crosses the border between two partitions, see [`partition`].
+    #[derive(Clone, Copy, Debug)]
+    struct BoundaryEdge {
+        edge: GraphId,
+        /// Partition of the tile the edge starts in.
+        partition: u32,
+        /// Partition of the tile the edge ends in.
+        target_partition: u32,
+    }
+
+    /// Node transition to another hierarchy level that crosses the border between two partitions, see
+    /// [`partition`].
+    #[derive(Clone, Copy, Debug)]
+    struct BoundaryTransition {
+        /// Node the transition starts at.
+        node: GraphId,
+        /// Node on another hierarchy level the transition leads to.
+        end_node: GraphId,
+        /// Partition of the tile the transition starts in.
+        partition: u32,
+        /// Partition of the tile the transition ends in.
+        target_partition: u32,
+    }
+
+    /// Assignment of tiles to partitions, built by [`partition`].
+    #[derive(Clone, Debug)]
+    struct Partitioning {
+        /// All tiles of the tileset, sorted by [`GraphId`].
+        tiles: Vec<GraphId>,
+        /// Partition of each tile in `tiles`.
+        partitions: Vec<u32>,
+        /// Edges between partitions, sorted by their start tile.
+        boundary_edges: Vec<BoundaryEdge>,
+        /// Transitions between hierarchy levels of different partitions, sorted by their start tile.
+        boundary_transitions: Vec<BoundaryTransition>,
+    }
+
+    /// Grid of travel times in seconds, built by [`time_raster`].
+    #[derive(Clone, Debug)]
+    struct TimeRaster {
+        /// Latitude of the southern edge of the first row.
+        south: f64,
+        /// Longitude of the western edge of the first column.
+        west: f64,
+        /// Size of a square cell in degrees.
+        cell_size: f64,
+        rows: u32,
+        columns: u32,
+        /// Minimal travel time per cell in row-major order from south-west, [`f32::INFINITY`] if the cell is
+        /// not reached.
+        times: Vec<f32>,
+    }
+
+    unsafe extern "C++" {
+        include!("valhalla/src/graph_tools.hpp");
+
+        #[namespace = "valhalla::baldr"]
+        type GraphId = crate::GraphId;
+        type TileSet = crate::ffi::TileSet;
+
+        fn validate_graph(tileset: &TileSet, max_errors: usize) -> Vec<ValidationError>;
+        fn partition_graph(
+            tileset: &TileSet,
+            partitions: u32,
+            imbalance: f32,
+        ) -> Result<Partitioning>;
+
+        type ConnectedComponents;
+        fn component(self: &ConnectedComponents, edge: GraphId) -> u32;
+        fn component_size(self: &ConnectedComponents, component: u32) -> u32;
+        fn component_count(self: &ConnectedComponents) -> usize;
+        fn save(self: &ConnectedComponents, path: &[u8]) -> Result<()>;
+        fn load_components(
+            tileset: &TileSet,
+            path: &[u8],
+        ) -> Result<SharedPtr<ConnectedComponents>>;
+    }
+
+    #[cfg(feature = "proto")]
+    unsafe extern "C++" {
+        #[namespace = "valhalla::sif"]
+        type DynamicCost = crate::ffi::DynamicCost;
+        type EdgeIndex = crate::edge_index::ffi::EdgeIndex;
+
+        fn strongly_connected_components(
+            tileset: &TileSet,
+            costing: &SharedPtr<DynamicCost>,
+        ) -> Result<SharedPtr<ConnectedComponents>>;
+        fn time_raster(
+            index: &EdgeIndex,
+            costing: &SharedPtr<DynamicCost>,
+            origins: &[f64],
+            snap_radius: f32,
+            max_time: f32,
+            cell_size: f64,
+        ) -> Result<TimeRaster>;
+        fn arrive_by_rasters(
+            index: &EdgeIndex,
+            costing: &SharedPtr<DynamicCost>,
+            targets: &[f64],
+            second_of_week: u32,
+            snap_radius: f32,
+            max_time: f32,
+            cell_size: f64,
+        ) -> Result<Vec<TimeRaster>>;
+        fn arrive_by_table(
+            index: &EdgeIndex,
+            costing: &SharedPtr<DynamicCost>,
+            sources: &[f64],
+            targets: &[f64],
+            second_of_week: u32,
+            snap_radius: f32,
+            max_time: f32,
+        ) -> Result<Vec<f32>>;
+    }
+}
+
+unsafe impl Send for ffi::ConnectedComponents {}
+unsafe impl Sync for ffi::ConnectedComponents {}
+
+impl fmt::Display for ValidationError {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        write!(f, "{:?} at {}: {}", self.kind, self.id, self.message)
+    }
+}
+
+/// Checks integrity of the whole tileset: tile headers, node edge and transition ranges, end nodes
+/// and opposing edges of all directed edges and symmetry of transitions between hierarchy levels.
+///
+/// Tiles are checked in parallel on all available cores. Stops after finding `max_errors` errors,
+/// so corrupted tilesets don't produce unbounded output. Returned errors are sorted by tile and an
+/// empty result means that the tileset is consistent.
+pub fn validate(reader: &GraphReader, max_errors: usize) -> Vec<ValidationError> {
+    ffi::validate_graph(&reader.0, max_errors)
+}
+
+/// Splits the tileset into `partitions` shards for distributed routing.
+///
+/// Tiles of all hierarchy levels are split by recursive coordinate bisection into geographically
+/// compact groups with similar numbers of directed edges, then refined by greedily moving border
+/// tiles to reduce the number of edges between partitions. `imbalance` is the allowed excess of the
+/// partition edge count over the average after the refinement, e.g. `0.1` for 10%.
+///
+/// Each shard can then be served by a [`GraphReader::subset`] of its tiles, while
+/// [`Partitioning::boundary_edges`] and [`Partitioning::boundary_transitions`] tell where routes
+/// continue into other shards, as tiles of different hierarchy levels may end up in different shards.
+///
+/// Fails if `partitions` is zero or exceeds the number of tiles, as some partitions would be empty.
+pub fn partition(
+    reader: &GraphReader,
+    partitions: u32,
+    imbalance: f32,
+) -> Result<Partitioning, Error> {
+    Ok(ffi::partition_graph(&reader.0, partitions, imbalance)?)
+}
+
+impl Partitioning {
+    /// Tiles assigned to the given partition.
+    pub fn tiles_in(&self, partition: u32) -> Vec<GraphId> {
+        self.tiles
+            .iter()
+            .zip(&self.partitions)
+            .filter(|&(_, &p)| p == partition)
+            .map(|(&tile, _)| tile)
+            .collect()
+    }
+
+    /// Partition of the tile the given [`GraphId`] belongs to.
+    pub fn partition_of(&self, id: GraphId) -> Option<u32> {
+        let tile = id.tile();
+        self.tiles
+            .binary_search_by_key(&tile.value, |t| t.value)
+            .ok()
+            .map(|index| self.partitions[index])
+    }
+}
+
+/// Travel time from the nearest of `origins` for the whole area reachable within `max_time` seconds, e.g.
+/// time to the nearest facility for accessibility studies.
+///
+/// Instead of an isochrone per origin, all origins are seeded into a single expansion, so the cost
+/// doesn't grow with the number of origins. Each origin is snapped to the closest road within
+/// `snap_radius` meters that is accessible with the costing, and origins without such roads are
+/// skipped. Reached edges are rasterized in parallel into a grid of `cell_size` degrees, keeping the
+/// minimal time per cell, and the result is the same regardless of the number of cores.
+///
+/// Travel times use default edge speeds and don't include turn costs.
+#[cfg(feature = "proto")]
+pub fn time_raster(
+    index: &EdgeIndex,
+    costing: &CostingModel,
+    origins: &[LatLon],
+    snap_radius: f32,
+    max_time: f32,
+    cell_size: f64,
+) -> Result<TimeRaster, Error> {
+    Ok(ffi::time_raster(
+        &index.0,
+        &costing.0,
+        flatten(origins),
+        snap_radius,
+        max_time,
+        cell_size,
+    )?)
+}
+
+/// Arrive-by isochrones of many targets, e.g. depots: for each target, the travel time to it from
+/// every place it can be reached from within `max_time` seconds, arriving at `second_of_week`.
+///
+/// The time is counted in seconds from Sunday midnight and edge speeds are taken from the predicted
+/// traffic at the time each edge is traversed, counting back from the arrival. Each target is
+/// expanded in reverse on its own core and rasterized like [`time_raster`], giving one raster per
+/// target in the same order.
+#[cfg(feature = "proto")]
+pub fn arrive_by_rasters(
+    index: &EdgeIndex,
+    costing: &CostingModel,
+    targets: &[LatLon],
+    second_of_week: u32,
+    snap_radius: f32,
+    max_time: f32,
+    cell_size: f64,
+) -> Result<Vec<TimeRaster>, Error> {
+    Ok(ffi::arrive_by_rasters(
+        &index.0,
+        &costing.0,
+        flatten(targets),
+        second_of_week,
+        snap_radius,
+        max_time,
+        cell_size,
+    )?)
+}
+
+/// Travel times in seconds from each source to each target, arriving at `second_of_week` with
+/// predicted traffic speeds, see [`arrive_by_rasters`]. A single reverse expansion per target is
+/// enough for all sources, so the cost grows only with the number of targets.
+///
+/// Returns a row-major table with a row per source. Pairs that are not reachable within `max_time`
+/// seconds are [`f32::INFINITY`].
+#[cfg(feature = "proto")]
+pub fn arrive_by_table(
+    index: &EdgeIndex,
+    costing: &CostingModel,
+    sources: &[LatLon],
+    targets: &[LatLon],
+    second_of_week: u32,
+    snap_radius: f32,
+    max_time: f32,
+) -> Result<Vec<f32>, Error> {
+    Ok(ffi::arrive_by_table(
+        &index.0,
+        &costing.0,
+        flatten(sources),
+        flatten(targets),
+        second_of_week,
+        snap_radius,
+        max_time,
+    )?)
+}
+
+/// Reinterprets coordinates as interleaved latitude and longitude pairs.
+#[cfg(feature = "proto")]
+fn flatten(points: &[LatLon]) -> &[f64] {
+    // SAFETY: `LatLon` is `#[repr(C)]` pair of `f64`, so the slice is a valid `[f64]` twice as long
+    unsafe { std::slice::from_raw_parts(points.as_ptr().cast::<f64>(), points.len() * 2) }
+}
+
+impl TimeRaster {
+    /// Travel time in the cell that contains the point, or `None` if the point is outside of the
+    /// raster or the cell is not reached.
+    pub fn time_at(&self, point: LatLon) -> Option<f32> {
+        let row = ((point.0 - self.south) / self.cell_size).floor();
+        let column = ((point.1 - self.west) / self.cell_size).floor();
+        if row < 0.0 || column < 0.0 || row >= self.rows as f64 || column >= self.columns as f64 {
+            return None;
+        }
+        let time = self.times[row as usize * self.columns as usize + column as usize];
+        time.is_finite().then_some(time)
+    }
+
+    /// Center of the cell in the given row and column.
+    pub fn cell_center(&self, row: u32, column: u32) -> LatLon {
+        LatLon(
+            self.south + (row as f64 + 0.5) * self.cell_size,
+            self.west + (column as f64 + 0.5) * self.cell_size,
+        )
+    }
+}
+
+/// Strongly connected components of the graph accessible with a [`CostingModel`], labelled per
+/// directed edge.
+///
+/// Small components are islands that are impossible to leave or enter, like a parking lot with
+/// the only entrance restricted for the travel mode. Snapping to them leads to failed routes, so
+/// candidates can be filtered by the size of their component:
+///
+/// ```no_run
+/// # fn example(reader: &valhalla::GraphReader) -> Result<(), valhalla::Error> {
+/// use valhalla::{CostingModel, EdgeIndex, LatLon, graph_tools::ConnectedComponents, proto};
+///
+/// let components = ConnectedComponents::new(reader, &CostingModel::new(proto::costing::Type::Auto)?)?;
+/// let index = EdgeIndex::new(reader)?;
+/// let candidates: Vec<_> = index
+///     .nearest(LatLon(42.50735, 1.52131), 100.0, 10)
+///     .into_iter()
+///     .filter(|c| components.edge_component_size(c.edge) >= 100)
+///     .collect();
+/// # Ok(())
+/// # }
+/// ```
+///
+/// As the components are immutable and use shared ownership internally, cloning is cheap and they
+/// can be shared between threads.
+#[derive(Clone)]
+pub struct ConnectedComponents(cxx::SharedPtr<ffi::ConnectedComponents>);
+
+impl ConnectedComponents {
+    /// Finds strongly connected components of the whole tileset on all hierarchy levels. Edges and
+    /// nodes that are not accessible with the costing don't belong to any component.
+    #[cfg(feature = "proto")]
+    pub fn new(reader: &GraphReader, costing: &CostingModel) -> Result<Self, Error> {
+        Ok(Self(ffi::strongly_connected_components(
+            &reader.0, &costing.0,
+        )?))
+    }
+
+    /// Memory-maps components previously written by [`ConnectedComponents::save`] for the same
+    /// tileset. Fails if the file was built for another tileset.
+    pub fn load(reader: &GraphReader, path: impl AsRef<Path>) -> Result<Self, Error> {
+        let path = path.as_ref().as_os_str().as_bytes();
+        Ok(Self(ffi::load_components(&reader.0, path)?))
+    }
+
+    /// Writes components into a sidecar file to skip the computation on startup.
+    pub fn save(&self, path: impl AsRef<Path>) -> Result<(), Error> {
+        Ok(self.0.save(path.as_ref().as_os_str().as_bytes())?)
+    }
+
+    /// Number of components.
+    pub fn len(&self) -> usize {
+        self.0.component_count()
+    }
+
+    /// Whether no edge is accessible with the costing.
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    /// Component of the directed edge or `None` if the edge is not accessible or leads out of its
+    /// start node component.
+    pub fn component(&self, edge: GraphId) -> Option<u32> {
+        match self.0.component(edge) {
+            u32::MAX => None,
+            component => Some(component),
+        }
+    }
+
+    /// Number of nodes in the component.
+    pub fn component_size(&self, component: u32) -> u32 {
+        self.0.component_size(component)
+    }
+
+    /// Number of nodes in the component of the directed edge or 0 if it has none.
+    pub fn edge_component_size(&self, edge: GraphId) -> u32 {
+        self.component(edge)
+            .map_or(0, |component| self.component_size(component))
+    }
+}
@@ -0,0 +1,91 @@
+use std::ops::AddAssign;
+
+use crate::TileHeader;
+
+/// Aggregated statistics of the tiles on a single hierarchy level, see [`Inventory`].
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub struct LevelInventory {
+    pub tiles: u64,
+    pub nodes: u64,
+    pub directed_edges: u64,
+    pub transitions: u64,
+    /// Size of the edge info sections, which mostly consist of encoded edge shapes.
+    pub shape_bytes: u64,
+    /// Total size of the tiles.
+    pub tile_bytes: u64,
+    /// Number of tiles that have a live traffic tile.
+    pub traffic_tiles: u64,
+    /// Number of directed edges in tiles that have a live traffic tile.
+    pub traffic_edges: u64,
+}
+
+impl LevelInventory {
+    /// Share of directed edges covered by live traffic tiles, from `0.0` to `1.0`.
+    pub fn traffic_coverage(&self) -> f64 {
+        if self.directed_edges == 0 {
+            0.0
+        } else {
+            self.traffic_edges as f64 / self.directed_edges as f64
+        }
+    }
+}
+
+impl AddAssign<&TileHeader> for LevelInventory {
+    fn add_assign(&mut self, header: &TileHeader) {
+        self.tiles += 1;
+        self.nodes += header.node_count as u64;
+        self.directed_edges += header.directed_edge_count as u64;
+        self.transitions += header.transition_count as u64;
+        self.shape_bytes += header.edge_info_size as u64;
+        self.tile_bytes += header.tile_size as u64;
+        if header.has_traffic {
+            self.traffic_tiles += 1;
+            self.traffic_edges += header.directed_edge_count as u64;
+        }
+    }
+}
+
+impl AddAssign<&LevelInventory> for LevelInventory {
+    fn add_assign(&mut self, other: &LevelInventory) {
+        self.tiles += other.tiles;
+        self.nodes += other.nodes;
+        self.directed_edges += other.directed_edges;
+        self.transitions += other.transitions;
+        self.shape_bytes += other.shape_bytes;
+        self.tile_bytes += other.tile_bytes;
+        self.traffic_tiles += other.traffic_tiles;
+        self.traffic_edges += other.traffic_edges;
+    }
+}
+
+/// Summary of the tileset contents for capacity planning, built from tile headers only.
+///
+/// Can be obtained via [`crate::GraphReader::inventory()`].
+#[derive(Clone, Debug, Default, PartialEq, Eq)]
+pub struct Inventory {
+    /// Statistics per hierarchy level, indexed by level. Levels without tiles have all counts set to zero.
+    pub levels: Vec<LevelInventory>,
+}
+
+impl Inventory {
+    pub(crate) fn from_headers(headers: &[TileHeader]) -> Self {
+        let mut levels = Vec::new();
+        for header in headers {
+            let level = header.graph_id.level() as usize;
+            if levels.len() <= level {
+                levels.resize(level + 1, LevelInventory::default());
+            }
+            levels[level] += header;
+        }
+        Self { levels }
+    }
+
+    /// Statistics summed over all hierarchy levels.
+    pub fn total(&self) -> LevelInventory {
+        let mut total = LevelInventory::default();
+        for level in &self.levels {
+            total += level;
+        }
+        total
+    }
+}
@@ -12,21 +12,34 @@ use prost::Message;
 mod actor;
 pub mod config;
 #[cfg(feature = "proto")]
+pub mod distributed;
+mod edge_index;
+pub mod graph_tools;
+mod inventory;
+pub mod logging;
+pub mod polyline;
+#[cfg(feature = "proto")]
 pub mod proto;
 
 #[cfg(feature = "proto")]
-pub use actor::{Actor, Response};
+pub use actor::{
+    ActionStats, Actor, ActorEndpoint, ActorStats, MatchedPoint, MatrixProfile, Response,
+    TraceMatch, TraceSession, TrafficAges,
+};
 pub use config::Config;
 pub use config::ConfigBuilder;
+pub use edge_index::{EdgeCandidate, EdgeIndex};
 pub use ffi::AdminInfo;
 pub use ffi::EdgeInfo;
 pub use ffi::EdgeUse;
 pub use ffi::GraphLevel;
 pub use ffi::RoadClass;
+pub use ffi::TileHeader;
 pub use ffi::TimeZoneInfo;
 pub use ffi::TrafficTile;
 pub use ffi::decode_weekly_speeds;
 pub use ffi::encode_weekly_speeds;
+pub use inventory::{Inventory, LevelInventory};
 
 #[cxx::bridge]
 mod ffi {
@@ -153,6 +166,36 @@ mod ffi {
         offset_seconds: i32,
     }
 
+    /// Graph tile metadata, read directly from the memory mapped tile header without constructing
+    /// the [`crate::GraphTile`].
+    ///
+    /// Can be obtained via [`crate::GraphReader::tile_header()`] or [`crate::GraphReader::tile_headers()`].
+    #[derive(Clone, Debug)]
+    struct TileHeader {
+        /// Base [`GraphId`] of the tile.
+        graph_id: GraphId,
+        /// Latest OSM changeset ID (or the maximum OSM Node/Way/Relation ID) used to build the tile.
+        dataset_id: u64,
+        /// Valhalla version that built the tile.
+        version: String,
+        /// Days since pivot date (2014-01-01) when the tile was created.
+        date_created: u32,
+        /// Coordinate of the south-west corner of the tile.
+        base_ll: LatLon,
+        node_count: u32,
+        directed_edge_count: u32,
+        transition_count: u32,
+        admin_count: u32,
+        /// Size in bytes of the edge info section, which mostly consists of encoded edge shapes.
+        edge_info_size: u32,
+        /// Size in bytes of the names section.
+        text_list_size: u32,
+        /// Total size of the tile in bytes.
+        tile_size: u32,
+        /// Whether the tileset has a live traffic tile for this tile.
+        has_traffic: bool,
+    }
+
     /// An interface for reading and writing live traffic information for the corresponding graph tile.
     ///
     /// Can be obtained via [`crate::GraphReader::traffic_tile()`].
@@ -204,6 +247,9 @@ mod ffi {
         fn get_graph_tile(self: &TileSet, id: GraphId) -> *const GraphTile;
         fn get_traffic_tile(self: &TileSet, id: GraphId) -> Result<TrafficTile>;
         fn dataset_id(self: &TileSet) -> u64;
+        fn tile_header(self: &TileSet, id: GraphId) -> Result<TileHeader>;
+        fn tile_headers(self: &TileSet) -> Vec<TileHeader>;
+        fn subset(self: &TileSet, tiles: &[GraphId]) -> SharedPtr<TileSet>;
 
         #[namespace = "valhalla::baldr"]
         type GraphTile;
@@ -225,6 +271,7 @@ mod ffi {
         fn node_edges<'a>(tile: &'a GraphTile, node: &NodeInfo) -> &'a [DirectedEdge];
         fn node_transitions<'a>(tile: &'a GraphTile, node: &NodeInfo) -> &'a [NodeTransition];
         fn node_latlon(tile: &GraphTile, node: &NodeInfo) -> LatLon;
+        fn node_latlons(tile: &GraphTile, latlons: &mut [f64]) -> Result<()>;
         fn admininfo(tile: &GraphTile, index: u32) -> Result<AdminInfo>;
         unsafe fn IsClosed(self: &GraphTile, de: *const DirectedEdge) -> bool;
         unsafe fn GetSpeed(
@@ -584,7 +631,11 @@ bitflags! {
 }
 
 /// Coordinate in (lat, lon) format.
-#[derive(Clone, Copy, Debug, PartialEq)]
+///
+/// `#[repr(C)]` guarantees that a slice of coordinates is laid out as interleaved `f64` pairs,
+/// which is used to fill them in bulk on the C++ side.
+#[derive(Clone, Copy, Debug, Default, PartialEq)]
+#[repr(C)]
 pub struct LatLon(pub f64, pub f64);
 
 #[cfg(feature = "proto")]
@@ -646,6 +697,32 @@ impl GraphReader {
         self.0.tiles()
     }
 
+    /// Header metadata of the tile with the given [`GraphId`] if it exists in the tileset.
+    /// Cheap as it reads the memory mapped header directly instead of constructing a [`GraphTile`].
+    pub fn tile_header(&self, id: GraphId) -> Option<TileHeader> {
+        self.0.tile_header(id).ok()
+    }
+
+    /// Header metadata of all tiles in the tileset, sorted by [`GraphId`].
+    pub fn tile_headers(&self) -> Vec<TileHeader> {
+        self.0.tile_headers()
+    }
+
+    /// Reader that sees only the given tiles of this tileset, e.g. a shard built by
+    /// [`graph_tools::partition`]. Tiles missing in this tileset are ignored.
+    ///
+    /// Memory mappings are shared with this reader, so it's cheap to create, and only pages of the
+    /// subset tiles are ever loaded into memory.
+    pub fn subset(&self, tiles: &[GraphId]) -> GraphReader {
+        GraphReader(self.0.subset(tiles))
+    }
+
+    /// Per-level counts of tiles, nodes, edges, shape bytes and traffic coverage of the tileset.
+    /// Only tile headers are read, so it takes milliseconds even for planetary tilesets.
+    pub fn inventory(&self) -> Inventory {
+        Inventory::from_headers(&self.tile_headers())
+    }
+
     /// List all tiles in the bounding box for a given hierarchy level in the tileset.
     pub fn tiles_in_bbox(&self, min: LatLon, max: LatLon, level: GraphLevel) -> Vec<GraphId> {
         self.0.tiles_in_bbox(
@@ -790,6 +867,29 @@ impl GraphTile {
         LatLon(latlon.lat, latlon.lon)
     }
 
+    /// Coordinates of all nodes in the tile, in the same order as [`GraphTile::nodes`].
+    /// Much cheaper than calling [`GraphTile::node_latlon`] for each node.
+    pub fn node_latlons(&self) -> Vec<LatLon> {
+        let mut latlons = vec![LatLon::default(); self.nodes().len()];
+        self.node_latlons_into(&mut latlons);
+        latlons
+    }
+
+    /// Same as [`GraphTile::node_latlons`] but writes coordinates into the given slice to reuse
+    /// allocations between tiles.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `latlons.len()` is not equal to the number of nodes in the tile.
+    pub fn node_latlons_into(&self, latlons: &mut [LatLon]) {
+        assert_eq!(latlons.len(), self.nodes().len(), "Wrong output size");
+        // SAFETY: `LatLon` is `#[repr(C)]` pair of `f64`, so the slice is a valid `[f64]` twice as long
+        let flat = unsafe {
+            std::slice::from_raw_parts_mut(latlons.as_mut_ptr().cast::<f64>(), latlons.len() * 2)
+        };
+        ffi::node_latlons(self.deref(), flat).expect("Output size is checked above");
+    }
+
     /// Slice of all outbound edges for the given node.
     #[inline(always)]
     pub fn node_edges<'a>(&'a self, node: &ffi::NodeInfo) -> &'a [ffi::DirectedEdge] {
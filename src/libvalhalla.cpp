@@ -1,12 +1,21 @@
 #include "libvalhalla.hpp"
 #include "valhalla/src/lib.rs.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <valhalla/baldr/datetime.h>
 #include <valhalla/baldr/graphreader.h>
-#include <valhalla/midgard/encoded.h>
 
 #include <boost/property_tree/ptree.hpp>
 
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+
 namespace baldr = valhalla::baldr;
 namespace midgard = valhalla::midgard;
 
@@ -21,6 +30,58 @@ struct GraphMemory : public baldr::GraphMemory {
   }
 };
 
+TileHeader make_tile_header(const baldr::GraphTileHeader& header, bool has_traffic) {
+  const auto base_ll = header.base_ll();
+  return TileHeader{
+    .graph_id = header.graphid(),
+    .dataset_id = header.dataset_id(),
+    .version = rust::String(header.version()),
+    .date_created = header.date_created(),
+    .base_ll = LatLon{ .lat = base_ll.lat(), .lon = base_ll.lng() },
+    .node_count = header.nodecount(),
+    .directed_edge_count = header.directededgecount(),
+    .transition_count = header.transitioncount(),
+    .admin_count = header.admincount(),
+    .edge_info_size = header.textlist_offset() - header.edgeinfo_offset(),
+    .text_list_size = header.end_offset() - header.textlist_offset(),
+    .tile_size = header.end_offset(),
+    .has_traffic = has_traffic,
+  };
+}
+
+/// Appends the zigzag-encoded value as 5-bit chunks, exactly like `midgard::encode` does.
+char* write_polyline_value(char* out, int32_t value) {
+  uint32_t bits = value < 0 ? ~(static_cast<uint32_t>(value) << 1) : static_cast<uint32_t>(value) << 1;
+  while (bits >= 0x20) {
+    *out++ = static_cast<char>((0x20 | (bits & 0x1f)) + 63);
+    bits >>= 5;
+  }
+  *out++ = static_cast<char>(bits + 63);
+  return out;
+}
+
+/// Appends points encoded as a polyline with 6 digits precision, giving the same output as `midgard::encode`. The
+/// buffer is sized for the worst case of 7 chunks per coordinate upfront and written through a raw pointer, so there
+/// is a single allocation and no per-character capacity checks.
+template <typename It>
+void encode_polyline6(It begin, It end, std::string& out) {
+  constexpr double kPrecision = 1e6;
+  const size_t start = out.size();
+  out.resize(start + static_cast<size_t>(std::distance(begin, end)) * 14);
+  char* cursor = out.data() + start;
+  int32_t last_lat = 0;
+  int32_t last_lon = 0;
+  for (auto it = begin; it != end; ++it) {
+    const auto lat = static_cast<int32_t>(std::round(static_cast<double>(it->lat()) * kPrecision));
+    const auto lon = static_cast<int32_t>(std::round(static_cast<double>(it->lng()) * kPrecision));
+    cursor = write_polyline_value(cursor, lat - last_lat);
+    cursor = write_polyline_value(cursor, lon - last_lon);
+    last_lat = lat;
+    last_lon = lon;
+  }
+  out.resize(static_cast<size_t>(cursor - out.data()));
+}
+
 }  // namespace
 
 TileSet::~TileSet() {}
@@ -117,30 +178,114 @@ TrafficTile TileSet::get_traffic_tile(baldr::GraphId id) const {
 
 uint64_t TileSet::dataset_id() const {
   if (auto it = tiles_.begin(); it != tiles_.end()) {
-    return get_graph_tile(baldr::GraphId(it->first))->header()->dataset_id();
+    return graph_tile_header(baldr::GraphId(it->first))->dataset_id();
   } else {
     return 0;
   }
 }
 
+const baldr::GraphTileHeader* TileSet::graph_tile_header(baldr::GraphId id) const {
+  auto tile_it = tiles_.find(id.tile_base());
+  if (tile_it == tiles_.end() || tile_it->second.second < sizeof(baldr::GraphTileHeader)) {
+    return nullptr;
+  }
+  return reinterpret_cast<const baldr::GraphTileHeader*>(tile_it->second.first);
+}
+
+TileHeader TileSet::tile_header(baldr::GraphId id) const {
+  const auto* header = graph_tile_header(id);
+  if (!header) {
+    throw std::runtime_error("No graph tile for the given id");
+  }
+  return make_tile_header(*header, traffic_tiles_.contains(id.tile_base()));
+}
+
+rust::Vec<TileHeader> TileSet::tile_headers() const {
+  std::vector<baldr::GraphId> tile_ids;
+  tile_ids.reserve(tiles_.size());
+  for (const auto& tile : tiles_) {
+    tile_ids.emplace_back(tile.first);
+  }
+  std::sort(tile_ids.begin(), tile_ids.end());
+
+  rust::Vec<TileHeader> headers;
+  headers.reserve(tile_ids.size());
+  for (const auto tile_id : tile_ids) {
+    if (const auto* header = graph_tile_header(tile_id)) {
+      headers.push_back(make_tile_header(*header, traffic_tiles_.contains(tile_id)));
+    }
+  }
+  return headers;
+}
+
+MappedFile map_file(rust::Slice<const uint8_t> path) {
+  const std::string file(reinterpret_cast<const char*>(path.data()), path.size());
+  const int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw std::runtime_error("Failed to open " + file + ": " + std::strerror(errno));
+  }
+  struct stat st{};
+  // Empty files can't be mapped, but there is nothing to read from them anyway
+  const bool ok = ::fstat(fd, &st) == 0 && st.st_size > 0;
+  void* data = ok ? ::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    throw std::runtime_error("Failed to map " + file);
+  }
+  const size_t size = st.st_size;
+  return MappedFile{
+    .data = std::shared_ptr<const void>(data, [size](const void* p) { ::munmap(const_cast<void*>(p), size); }),
+    .size = size,
+  };
+}
+
+std::shared_ptr<TileSet> TileSet::subset(rust::Slice<const baldr::GraphId> tiles) const {
+  auto subset = std::make_shared<TileSet>();
+  subset->tar_ = tar_;
+  subset->traffic_tar_ = traffic_tar_;
+  for (const auto id : tiles) {
+    const auto base = id.tile_base();
+    if (auto it = tiles_.find(base); it != tiles_.end()) {
+      subset->tiles_.insert(*it);
+    }
+    if (auto it = traffic_tiles_.find(base); it != traffic_tiles_.end()) {
+      subset->traffic_tiles_.insert(*it);
+    }
+  }
+  return subset;
+}
+
 LatLon node_latlon(const baldr::GraphTile& tile, const baldr::NodeInfo& node) {
   const auto base_ll = tile.header()->base_ll();
   const auto ll = node.latlng(base_ll);
   return LatLon{ .lat = ll.lat(), .lon = ll.lng() };
 }
 
+void node_latlons(const baldr::GraphTile& tile, rust::Slice<double> latlons) {
+  const auto nodes = tile.GetNodes();
+  if (latlons.size() != nodes.size() * 2) {
+    throw std::runtime_error("Output size doesn't match the number of nodes in the tile");
+  }
+  // Tile base is resolved once per tile instead of once per node
+  const auto base_ll = tile.header()->base_ll();
+  double* out = latlons.data();
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    const auto ll = nodes[i].latlng(base_ll);
+    out[2 * i] = ll.lat();
+    out[2 * i + 1] = ll.lng();
+  }
+}
+
 EdgeInfo edgeinfo(const baldr::GraphTile& tile, const baldr::DirectedEdge& de) {
   const auto edge_info = tile.edgeinfo(&de);
+  const auto edge_shape = edge_info.shape();
 
-  rust::string shape;
+  // If the edge is not forward, the shape is encoded backwards instead of reversing a copy
+  std::string shape;
   if (de.forward()) {
-    // todo: use `edge_info.lazy_shape()` for better performance
-    shape = midgard::encode(edge_info.shape());
+    encode_polyline6(edge_shape.begin(), edge_shape.end(), shape);
   } else {
-    // If the edge is not forward, we need to reverse the shape
-    std::vector<midgard::PointLL> edge_shape = edge_info.shape();
-    std::reverse(edge_shape.begin(), edge_shape.end());
-    shape = midgard::encode(edge_shape);
+    encode_polyline6(edge_shape.rbegin(), edge_shape.rend(), shape);
   }
 
   return EdgeInfo{
@@ -149,7 +294,7 @@ EdgeInfo edgeinfo(const baldr::GraphTile& tile, const baldr::DirectedEdge& de) {
     .speed_limit = static_cast<uint8_t>(edge_info.speed_limit()),
     // todo: directionality!
     // todo: use `edge_info.lazy_shape()` for better performance
-    .shape = std::move(shape),
+    .shape = rust::String(shape.data(), shape.size()),
   };
 }
 
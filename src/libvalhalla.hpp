@@ -15,6 +15,7 @@ struct EdgeInfo;
 struct TimeZoneInfo;
 struct TrafficTile;
 struct LatLon;
+struct TileHeader;
 
 enum class GraphLevel : uint8_t {
   Highway = 0,
@@ -43,6 +44,13 @@ struct TileSet {
   const valhalla::baldr::GraphTile* get_graph_tile(valhalla::baldr::GraphId id) const;
   TrafficTile get_traffic_tile(valhalla::baldr::GraphId id) const;
   uint64_t dataset_id() const;
+  TileHeader tile_header(valhalla::baldr::GraphId id) const;
+  rust::Vec<TileHeader> tile_headers() const;
+  /// Tileset with only the given tiles, sharing memory mappings with this one.
+  std::shared_ptr<TileSet> subset(rust::Slice<const valhalla::baldr::GraphId> tiles) const;
+
+  /// Header of the tile at the start of its memory mapped bytes. No tile is constructed, so it costs nothing.
+  const valhalla::baldr::GraphTileHeader* graph_tile_header(valhalla::baldr::GraphId id) const;
 };
 
 /// Creates a new [`TileSet`] instance based on a Valhalla's config.
@@ -96,9 +104,21 @@ inline rust::Slice<const valhalla::baldr::NodeTransition> node_transitions(const
   return rust::Slice(slice.data(), slice.size());
 }
 
+/// Read-only memory mapping of a whole file, unmapped once the last copy of `data` is released.
+struct MappedFile {
+  std::shared_ptr<const void> data;
+  size_t size;
+};
+
+/// Maps the file at the given path into memory, used for sidecar files built next to the tileset.
+MappedFile map_file(rust::Slice<const uint8_t> path);
+
 /// Helper function to get lat,lng for the given node
 LatLon node_latlon(const valhalla::baldr::GraphTile& tile, const valhalla::baldr::NodeInfo& node);
 
+/// Decodes coordinates of all nodes in the tile into interleaved (lat, lon) pairs in a single pass
+void node_latlons(const valhalla::baldr::GraphTile& tile, rust::Slice<double> latlons);
+
 /// Helper function that workarounds the inability to use `baldr::EdgeInfo` in Rust
 EdgeInfo edgeinfo(const valhalla::baldr::GraphTile& tile, const valhalla::baldr::DirectedEdge& de);
 
@@ -129,7 +149,8 @@ inline rust::String encode_weekly_speeds(rust::Slice<const float> speeds) {
   return valhalla::baldr::encode_compressed_speeds(compressed.data());
 }
 
-/// Helper function that decodes predicted speeds from a base64 string into an array or floats
+/// Helper function that decodes predicted speeds from a base64 string into an array or floats. Each bucket is an
+/// out-of-line call into Valhalla, so the loop is not a `TARGET_CLONES` candidate.
 inline rust::Vec<float> decode_weekly_speeds(rust::Str encoded) {
   // todo: replace by std::string_view once Valhalla supports it
   std::string encoded_str(encoded.data(), encoded.size());
@@ -0,0 +1,204 @@
+#include "logging.hpp"
+#include "valhalla/src/logging.rs.h"
+
+#include <valhalla/midgard/logging.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <string_view>
+
+namespace logging = valhalla::midgard::logging;
+
+namespace {
+
+/// Bounded lock-free MPMC queue of fixed-size log records (Dmitry Vyukov's algorithm). Each slot carries a sequence
+/// number that tells producers and consumers whether the slot is free or holds a record for the given position, so
+/// pushing a message is one CAS on the tail and a copy into preallocated memory, without locks or allocations.
+class LogRing {
+public:
+  /// Longer messages are truncated, so the whole slot fits in 512 bytes.
+  static constexpr size_t kMaxMessage = 500;
+
+  explicit LogRing(size_t capacity)
+      : mask_(std::bit_ceil(std::max<size_t>(capacity, 2)) - 1), slots_(std::make_unique<Slot[]>(mask_ + 1)) {
+    for (size_t i = 0; i <= mask_; ++i) {
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  bool push(uint8_t level, std::string_view message) {
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+      slot = &slots_[pos & mask_];
+      const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+      const auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;  // The ring is full
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+    slot->level = level;
+    slot->length = static_cast<uint16_t>(std::min(message.size(), kMaxMessage));
+    std::memcpy(slot->text, message.data(), slot->length);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(LogRecord& record) {
+    size_t pos = head_.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+      slot = &slots_[pos & mask_];
+      const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+      const auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;  // The ring is empty
+      } else {
+        pos = head_.load(std::memory_order_relaxed);
+      }
+    }
+    record.level = slot->level;
+    // Truncation may split a multibyte character
+    record.message = rust::String::lossy(slot->text, slot->length);
+    slot->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+private:
+  struct Slot {
+    std::atomic<size_t> sequence;
+    uint8_t level;
+    uint16_t length;
+    char text[kMaxMessage];
+  };
+
+  const size_t mask_;
+  std::unique_ptr<Slot[]> slots_;
+  // Producers and consumers touch different counters, so they are kept on different cache lines
+  alignas(64) std::atomic<size_t> tail_ = 0;
+  alignas(64) std::atomic<size_t> head_ = 0;
+};
+
+/// Approximate limit of messages per second: the counter is reset by whichever thread notices a new second first,
+/// so a few extra messages may pass around the boundary.
+class RateLimiter {
+public:
+  explicit RateLimiter(uint32_t max_per_second) : max_per_second_(max_per_second) {}
+
+  bool allow() {
+    if (max_per_second_ == 0) {
+      return true;
+    }
+    const int64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+                            std::chrono::steady_clock::now().time_since_epoch())
+                            .count();
+    int64_t second = second_.load(std::memory_order_relaxed);
+    if (second != now && second_.compare_exchange_strong(second, now, std::memory_order_relaxed)) {
+      count_.store(0, std::memory_order_relaxed);
+    }
+    return count_.fetch_add(1, std::memory_order_relaxed) < max_per_second_;
+  }
+
+private:
+  const uint32_t max_per_second_;
+  std::atomic<int64_t> second_ = 0;
+  std::atomic<uint32_t> count_ = 0;
+};
+
+struct LogSink {
+  LogRing ring;
+  RateLimiter limiter;
+  std::atomic<uint64_t> dropped_full = 0;
+  std::atomic<uint64_t> dropped_rate_limited = 0;
+
+  void log(uint8_t level, std::string_view message) {
+    if (!limiter.allow()) {
+      dropped_rate_limited.fetch_add(1, std::memory_order_relaxed);
+    } else if (!ring.push(level, message)) {
+      dropped_full.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+};
+
+/// Set once by [`install_ring_logger()`] and never destroyed, as Valhalla may log until the process exits.
+std::atomic<LogSink*> sink = nullptr;
+
+constexpr uint8_t kTraceLevel = static_cast<uint8_t>(logging::LogLevel::TRACE);
+
+/// Valhalla logger that forwards all messages to the [`LogSink`] instead of writing them out.
+class RingLogger final : public logging::Logger {
+public:
+  explicit RingLogger(const logging::LoggingConfig& config) : logging::Logger(config) {}
+
+  void Log(const std::string& message, const logging::LogLevel level) override {
+    sink.load(std::memory_order_acquire)->log(static_cast<uint8_t>(level), message);
+  }
+
+  void Log(const std::string& message, const std::string& custom_directive) override {
+    // Custom directives are only used for trace messages, e.g. " [TRACE] "
+    sink.load(std::memory_order_acquire)->log(kTraceLevel, message);
+  }
+};
+
+}  // namespace
+
+void install_ring_logger(size_t capacity, uint32_t max_per_second) {
+  auto* new_sink = new LogSink{.ring = LogRing(capacity), .limiter = RateLimiter(max_per_second)};
+  LogSink* expected = nullptr;
+  if (!sink.compare_exchange_strong(expected, new_sink, std::memory_order_acq_rel)) {
+    delete new_sink;
+    throw std::runtime_error("Ring logger is already installed");
+  }
+  logging::RegisterLogger("rust_ring", [](const logging::LoggingConfig& config) -> logging::Logger* {
+    return new RingLogger(config);
+  });
+  logging::Configure({{"type", "rust_ring"}});
+  // Valhalla creates its global logger only once, so `Configure` is a no-op if anything was logged before
+  if (dynamic_cast<RingLogger*>(&logging::GetLogger()) == nullptr) {
+    sink.store(nullptr, std::memory_order_release);
+    delete new_sink;
+    throw std::runtime_error("Valhalla logger is already configured, so the ring logger can't replace it");
+  }
+}
+
+rust::Vec<LogRecord> drain_logs(size_t max) {
+  rust::Vec<LogRecord> records;
+  LogSink* current = sink.load(std::memory_order_acquire);
+  if (current == nullptr) {
+    return records;
+  }
+  LogRecord record;
+  while (records.size() < max && current->ring.pop(record)) {
+    records.push_back(std::move(record));
+  }
+  return records;
+}
+
+LogCounters log_counters() {
+  LogSink* current = sink.load(std::memory_order_acquire);
+  if (current == nullptr) {
+    return LogCounters{};
+  }
+  return LogCounters{
+    .dropped_full = current->dropped_full.load(std::memory_order_relaxed),
+    .dropped_rate_limited = current->dropped_rate_limited.load(std::memory_order_relaxed),
+  };
+}
+
+void write_log(uint8_t level, rust::Str message) {
+  logging::GetLogger().Log(static_cast<std::string>(message), static_cast<logging::LogLevel>(level));
+}
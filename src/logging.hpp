@@ -0,0 +1,22 @@
+#pragma once
+
+#include "rust/cxx.h"
+
+#include <cstdint>
+
+// Forward Declarations for shared types, defined in logging.rs
+struct LogRecord;
+struct LogCounters;
+
+/// Replaces Valhalla's global logger with a logger that pushes messages into a lock-free ring buffer of `capacity`
+/// records, to be drained by [`drain_logs()`]. Logging threads never block: messages are dropped when the ring is
+/// full or when more than `max_per_second` messages arrive within a second, with `0` meaning no limit.
+void install_ring_logger(size_t capacity, uint32_t max_per_second);
+
+/// Pops up to `max` oldest messages from the ring buffer.
+rust::Vec<LogRecord> drain_logs(size_t max);
+
+LogCounters log_counters();
+
+/// Writes the message through Valhalla's global logger, whichever is installed.
+void write_log(uint8_t level, rust::Str message);
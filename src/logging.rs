@@ -0,0 +1,110 @@
+//! Routing of Valhalla's log messages to Rust.
+//!
+//! By default Valhalla writes its log messages synchronously to stderr under a global mutex, which serializes
+//! routing threads when many requests fail at once. [`install()`] replaces this logger with a lock-free ring buffer,
+//! which the application drains on its own schedule with [`drain()`], e.g. forwarding messages to `tracing` or
+//! `log`. Only messages of [`Level::Warn`] and above are compiled into Valhalla.
+//!
+//! ```
+//! # fn forward_logs() -> Result<(), valhalla::Error> {
+//! use valhalla::logging;
+//!
+//! // Must happen before Valhalla logs anything, i.e. before creating actors or graph readers
+//! logging::install(4096, 1000)?;
+//! std::thread::spawn(|| loop {
+//!     logging::drain(|level, message| eprintln!("valhalla {level:?}: {message}"));
+//!     std::thread::sleep(std::time::Duration::from_millis(100));
+//! });
+//! # Ok(())
+//! # }
+//! ```
+
+use crate::Error;
+
+#[cxx::bridge]
+mod ffi {
+    struct LogRecord {
+        level: u8,
+        message: String,
+    }
+
+    /// Numbers of messages dropped by the ring logger, see [`counters()`].
+    #[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+    struct LogCounters {
+        /// Messages dropped because the ring buffer was full, i.e. it wasn't drained often enough.
+        dropped_full: u64,
+        /// Messages dropped because of the rate limit.
+        dropped_rate_limited: u64,
+    }
+
+    unsafe extern "C++" {
+        include!("valhalla/src/logging.hpp");
+
+        fn install_ring_logger(capacity: usize, max_per_second: u32) -> Result<()>;
+        fn drain_logs(max: usize) -> Vec<LogRecord>;
+        fn log_counters() -> LogCounters;
+        fn write_log(level: u8, message: &str);
+    }
+}
+
+pub use ffi::LogCounters;
+
+/// Severity of a log message, in the order of `valhalla::midgard::logging::LogLevel`.
+#[derive(Clone, Copy, Debug, PartialEq, Eq, PartialOrd, Ord, Hash)]
+pub enum Level {
+    Trace = 0,
+    Debug = 1,
+    Info = 2,
+    Warn = 3,
+    Error = 4,
+}
+
+impl Level {
+    fn from_raw(level: u8) -> Self {
+        match level {
+            0 => Level::Trace,
+            1 => Level::Debug,
+            2 => Level::Info,
+            3 => Level::Warn,
+            _ => Level::Error,
+        }
+    }
+}
+
+/// Replaces Valhalla's global logger with a lock-free ring buffer of `capacity` messages, rounded up to a power of
+/// two. Logging threads never block: messages are dropped when the ring is full or when more than `max_per_second`
+/// messages arrive within a second, with `0` meaning no limit. Messages longer than 500 bytes are truncated.
+///
+/// Valhalla creates its global logger on the first log message and never replaces it, so this should be called at
+/// startup, before any actor or graph reader is created. Fails if the ring logger is already installed or if
+/// Valhalla has already created its default logger.
+pub fn install(capacity: usize, max_per_second: u32) -> Result<(), Error> {
+    Ok(ffi::install_ring_logger(capacity, max_per_second)?)
+}
+
+/// Calls `f` for all messages in the ring buffer, oldest first, and returns their number. Messages are copied out in
+/// batches, so `f` doesn't hold up logging threads. Does nothing if the ring logger is not installed.
+pub fn drain(mut f: impl FnMut(Level, &str)) -> usize {
+    const BATCH: usize = 256;
+    let mut drained = 0;
+    loop {
+        let records = ffi::drain_logs(BATCH);
+        for record in &records {
+            f(Level::from_raw(record.level), &record.message);
+        }
+        drained += records.len();
+        if records.len() < BATCH {
+            return drained;
+        }
+    }
+}
+
+/// Numbers of messages dropped by the ring logger since it was installed.
+pub fn counters() -> LogCounters {
+    ffi::log_counters()
+}
+
+/// Writes a message through Valhalla's global logger, e.g. to interleave application messages with Valhalla's.
+pub fn log(level: Level, message: &str) {
+    ffi::write_log(level as u8, message);
+}
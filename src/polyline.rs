@@ -0,0 +1,144 @@
+//! Encoding and decoding of [encoded polylines], used by Valhalla for route and edge shapes.
+//!
+//! Valhalla uses 6 digits precision (polyline6) by default, e.g. for [`crate::EdgeInfo::shape`], while
+//! other services often use the original 5 digits precision.
+//!
+//! [encoded polylines]: https://developers.google.com/maps/documentation/utilities/polylinealgorithm
+
+use crate::{Error, LatLon};
+
+/// Precision of polylines produced by Valhalla.
+pub const PRECISION6: u32 = 6;
+/// Precision of the original Google polyline format.
+pub const PRECISION5: u32 = 5;
+
+fn scale(precision: u32) -> f64 {
+    10f64.powi(precision as i32)
+}
+
+/// Encodes points with the given number of decimal digits, e.g. [`PRECISION6`].
+///
+/// ```
+/// use valhalla::{LatLon, polyline};
+///
+/// let points = [LatLon(38.5, -120.2), LatLon(40.7, -120.95), LatLon(43.252, -126.453)];
+/// assert_eq!(polyline::encode(&points, polyline::PRECISION5), "_p~iF~ps|U_ulLnnqC_mqNvxq`@");
+/// ```
+pub fn encode(points: &[LatLon], precision: u32) -> String {
+    let mut out = String::new();
+    encode_into(points, precision, &mut out);
+    out
+}
+
+/// Appends encoded points to `out`, so a single buffer can be reused for many shapes.
+pub fn encode_into(points: &[LatLon], precision: u32, out: &mut String) {
+    let scale = scale(precision);
+    // Each coordinate takes at most 7 chunks, so the buffer is reserved once and chunks are written
+    // without capacity checks in between
+    let mut bytes = std::mem::take(out).into_bytes();
+    bytes.reserve(points.len() * 14);
+    let (mut last_lat, mut last_lon) = (0i64, 0i64);
+    for point in points {
+        let lat = (point.0 * scale).round() as i64;
+        let lon = (point.1 * scale).round() as i64;
+        write_value(&mut bytes, lat - last_lat);
+        write_value(&mut bytes, lon - last_lon);
+        (last_lat, last_lon) = (lat, lon);
+    }
+    // SAFETY: only ASCII characters from `?` to `~` are written
+    *out = unsafe { String::from_utf8_unchecked(bytes) };
+}
+
+#[inline(always)]
+fn write_value(out: &mut Vec<u8>, value: i64) {
+    let mut bits = ((value << 1) ^ (value >> 63)) as u64;
+    while bits >= 0x20 {
+        out.push(((0x20 | (bits & 0x1f)) + 63) as u8);
+        bits >>= 5;
+    }
+    out.push((bits + 63) as u8);
+}
+
+/// Decodes points encoded with the given number of decimal digits, e.g. [`PRECISION6`].
+pub fn decode(encoded: &str, precision: u32) -> Result<Vec<LatLon>, Error> {
+    let mut points = Vec::new();
+    decode_into(encoded, precision, &mut points)?;
+    Ok(points)
+}
+
+/// Appends decoded points to `points`, so a single buffer can be reused for many shapes.
+pub fn decode_into(encoded: &str, precision: u32, points: &mut Vec<LatLon>) -> Result<(), Error> {
+    let scale = 1.0 / scale(precision);
+    let bytes = encoded.as_bytes();
+    // Each point takes at least 2 bytes
+    points.reserve(bytes.len() / 2);
+    let (mut lat, mut lon) = (0i64, 0i64);
+    let mut pos = 0;
+    while pos < bytes.len() {
+        lat += read_value(bytes, &mut pos)?;
+        lon += read_value(bytes, &mut pos)?;
+        points.push(LatLon(lat as f64 * scale, lon as f64 * scale));
+    }
+    Ok(())
+}
+
+#[inline(always)]
+fn read_value(bytes: &[u8], pos: &mut usize) -> Result<i64, Error> {
+    let mut bits = 0u64;
+    let mut shift = 0;
+    loop {
+        let Some(&byte) = bytes.get(*pos) else {
+            return Err(Error("Truncated polyline".into()));
+        };
+        *pos += 1;
+        let chunk = byte.wrapping_sub(63) as u64;
+        if chunk > 0x3f || shift > 60 {
+            return Err(Error("Invalid polyline".into()));
+        }
+        bits |= (chunk & 0x1f) << shift;
+        shift += 5;
+        if chunk < 0x20 {
+            break;
+        }
+    }
+    Ok(((bits >> 1) as i64) ^ -((bits & 1) as i64))
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn roundtrip() {
+        let points = [
+            LatLon(42.506271, 1.521734),
+            LatLon(42.501073, 1.510342),
+            LatLon(-33.868820, 151.209296),
+            LatLon(0.0, 0.0),
+            LatLon(-89.999999, -179.999999),
+        ];
+        for precision in [PRECISION5, PRECISION6] {
+            let decoded = decode(&encode(&points, precision), precision).unwrap();
+            assert_eq!(decoded.len(), points.len());
+            let tolerance = 0.6 / scale(precision);
+            for (a, b) in decoded.iter().zip(&points) {
+                assert!((a.0 - b.0).abs() < tolerance && (a.1 - b.1).abs() < tolerance);
+            }
+        }
+
+        let mut buffer = String::from("prefix");
+        encode_into(&points[..1], PRECISION6, &mut buffer);
+        assert_eq!(&buffer[6..], encode(&points[..1], PRECISION6));
+    }
+
+    #[test]
+    fn invalid() {
+        assert!(decode("", PRECISION6).unwrap().is_empty());
+        // Longitude is missing
+        assert!(decode("_p~iF", PRECISION5).is_err());
+        // Continuation chunk at the end
+        assert!(decode("_p~iF~", PRECISION5).is_err());
+        // Character below `?`
+        assert!(decode("_p~iF ", PRECISION5).is_err());
+    }
+}
@@ -1,7 +1,8 @@
 #![cfg(feature = "proto")]
 
 use valhalla::{
-    Actor, ConfigBuilder, Error, LatLon, Response,
+    Actor, ActorEndpoint, ConfigBuilder, Error, LatLon, Response,
+    distributed::{self, ChannelWorker},
     proto::{self, options::Format},
 };
 
@@ -342,7 +343,579 @@ fn parse_api() {
     .build();
     let mut actor = Actor::new(&config).unwrap();
     let response = actor.route(&request);
-    let Ok(Response::Json(_)) = response else {
+    let Ok(Response::Json(parsed_json)) = response else {
         panic!("Expected JSON response, got: {response:?}");
     };
+
+    // Executing JSON directly gives the same route, without the `ignore_closures` workaround
+    let response = actor.act_json(proto::options::Action::Route, json);
+    let Ok(Response::Json(direct_json)) = response else {
+        panic!("Expected JSON response, got: {response:?}");
+    };
+    let summary = |json: &str| {
+        json[json.find("\"summary\"").unwrap()..]
+            .split('}')
+            .next()
+            .unwrap()
+            .to_owned()
+    };
+    assert_eq!(summary(&direct_json), summary(&parsed_json));
+
+    let pbf_json = json.replacen('{', r#"{"format":"pbf","#, 1);
+    let response = actor.act_json(proto::options::Action::Route, &pbf_json);
+    let Ok(Response::Pbf(_)) = response else {
+        panic!("Expected PBF response, got: {response:?}");
+    };
+
+    assert!(actor.act_json(proto::options::Action::Route, "").is_err());
+    assert!(actor.act_json(proto::options::Action::Route, "{").is_err());
+}
+
+#[test]
+fn route_parallel() {
+    let config = ConfigBuilder {
+        mjolnir: valhalla::config::Mjolnir {
+            tile_extract: ANDORRA_TILES.into(),
+            traffic_extract: ANDORRA_TRAFFIC.into(),
+            ..Default::default()
+        },
+        ..Default::default()
+    }
+    .build();
+    let mut actors: Vec<_> = (0..3).map(|_| Actor::new(&config).unwrap()).collect();
+
+    let request = proto::Options {
+        format: Format::Pbf as i32,
+        pbf_field_selector: Some(proto::PbfFieldSelector {
+            trip: true,
+            directions: true,
+            ..Default::default()
+        }),
+        costing_type: proto::costing::Type::Auto as i32,
+        locations: [
+            ANDORRA_TEST_LOC_1,
+            ANDORRA_TEST_LOC_2,
+            LatLon(42.54381401912126, 1.4756460643803673),
+            ANDORRA_TEST_LOC_1,
+        ]
+        .into_iter()
+        .map(|ll| proto::Location {
+            ll: ll.into(),
+            ..Default::default()
+        })
+        .collect(),
+        ..Default::default()
+    };
+
+    let Ok(Response::Pbf(sequential)) = actors[0].route(&request) else {
+        panic!("Expected PBF response");
+    };
+    let Ok(Response::Pbf(parallel)) = Actor::route_parallel(&mut actors, &request) else {
+        panic!("Expected PBF response");
+    };
+
+    // Legs between break locations are independent, so stitched legs should be the same
+    let directions_legs = |api: &proto::Api| api.directions.clone().unwrap().routes[0].legs.clone();
+    let sequential_legs = directions_legs(&sequential);
+    let parallel_legs = directions_legs(&parallel);
+    assert_eq!(parallel_legs.len(), 3);
+    assert_eq!(parallel_legs.len(), sequential_legs.len());
+    for (i, (a, b)) in parallel_legs.iter().zip(&sequential_legs).enumerate() {
+        assert_eq!(a.leg_id, i as u32);
+        assert_eq!(a.leg_count, 3);
+        assert_eq!(a.shape, b.shape, "Leg {i} shape mismatch");
+    }
+    let trip_legs = &parallel.trip.as_ref().unwrap().routes[0].legs;
+    assert_eq!(trip_legs.len(), 3);
+    // Only the fields selected by the caller are returned
+    assert!(sequential.options.is_none());
+    assert!(parallel.options.is_none());
+
+    // Other formats are serialized from the stitched route
+    for format in [Format::Json, Format::Osrm] {
+        let request = proto::Options {
+            format: format as i32,
+            ..request.clone()
+        };
+        let response = Actor::route_parallel(&mut actors, &request);
+        let Ok(Response::Json(json)) = response else {
+            panic!("Expected JSON response for {format:?}, got: {response:?}");
+        };
+        assert!(json.starts_with('{') && json.ends_with('}'));
+    }
+
+    assert!(Actor::route_parallel(&mut [], &request).is_err());
+}
+
+#[test]
+fn distributed_matrix() {
+    let config = ConfigBuilder {
+        mjolnir: valhalla::config::Mjolnir {
+            tile_extract: ANDORRA_TILES.into(),
+            traffic_extract: ANDORRA_TRAFFIC.into(),
+            ..Default::default()
+        },
+        ..Default::default()
+    }
+    .build();
+    let locations: Vec<_> = [
+        ANDORRA_TEST_LOC_1,
+        ANDORRA_TEST_LOC_2,
+        LatLon(42.54381401912126, 1.4756460643803673),
+        LatLon(42.56, 1.59),
+        LatLon(42.46, 1.49),
+    ]
+    .into_iter()
+    .map(|ll| proto::Location {
+        ll: ll.into(),
+        ..Default::default()
+    })
+    .collect();
+    let request = proto::Options {
+        format: Format::Pbf as i32,
+        costing_type: proto::costing::Type::Auto as i32,
+        sources: locations.clone(),
+        targets: locations,
+        ..Default::default()
+    };
+
+    let mut actor = Actor::new(&config).unwrap();
+    let Ok(Response::Pbf(single)) = actor.matrix(&request) else {
+        panic!("Expected PBF response");
+    };
+    let mut workers: Vec<_> = (0..3)
+        .map(|_| ChannelWorker::spawn(&config).unwrap())
+        .collect();
+    let Ok(Response::Pbf(merged)) = distributed::matrix(&mut workers, &request) else {
+        panic!("Expected PBF response");
+    };
+
+    assert_eq!(merged.options, single.options);
+    let single = single.matrix.unwrap();
+    let merged = merged.matrix.unwrap();
+    assert_eq!(merged.algorithm, single.algorithm);
+    assert_eq!(merged.from_indices, single.from_indices);
+    assert_eq!(merged.to_indices, single.to_indices);
+    assert_eq!(merged.distances.len(), 25);
+    assert_eq!(merged.distances, single.distances);
+    assert_eq!(merged.times, single.times);
+
+    // Correlated sources are merged from the blocks instead of being replaced by the requested ones
+    let request = proto::Options {
+        pbf_field_selector: Some(proto::PbfFieldSelector {
+            options: true,
+            matrix: true,
+            ..Default::default()
+        }),
+        ..request
+    };
+    let Ok(Response::Pbf(single)) = actor.matrix(&request) else {
+        panic!("Expected PBF response");
+    };
+    let Ok(Response::Pbf(merged)) = distributed::matrix(&mut workers, &request) else {
+        panic!("Expected PBF response");
+    };
+    let (single, merged) = (single.options.unwrap(), merged.options.unwrap());
+    assert_eq!(merged.sources, single.sources);
+    assert!(
+        merged
+            .sources
+            .iter()
+            .all(|source| source.correlation.is_some())
+    );
+
+    // Local actors work as workers too, and other formats are serialized from the merged matrix
+    let mut actors = vec![actor, Actor::new(&config).unwrap()];
+    let request = proto::Options {
+        format: Format::Json as i32,
+        pbf_field_selector: None,
+        ..request
+    };
+    let response = distributed::matrix(&mut actors, &request);
+    let Ok(Response::Json(json)) = response else {
+        panic!("Expected JSON response, got: {response:?}");
+    };
+    assert!(json.contains("sources_to_targets"));
+
+    assert!(distributed::matrix::<Actor>(&mut [], &request).is_err());
+}
+
+#[test]
+fn matrix_profile() {
+    let config = ConfigBuilder {
+        mjolnir: valhalla::config::Mjolnir {
+            tile_extract: ANDORRA_TILES.into(),
+            traffic_extract: ANDORRA_TRAFFIC.into(),
+            ..Default::default()
+        },
+        ..Default::default()
+    }
+    .build();
+    let mut actor = Actor::new(&config).unwrap();
+    let locations: Vec<_> = [ANDORRA_TEST_LOC_1, ANDORRA_TEST_LOC_2]
+        .into_iter()
+        .map(|ll| proto::Location {
+            ll: ll.into(),
+            ..Default::default()
+        })
+        .collect();
+    let request = proto::Options {
+        costing_type: proto::costing::Type::Auto as i32,
+        sources: locations.clone(),
+        targets: locations,
+        date_time_type: proto::options::DateTimeType::DepartAt as i32,
+        has_date_time: Some(proto::options::HasDateTime::DateTime(
+            "2025-06-02T23:00".into(),
+        )),
+        ..Default::default()
+    };
+
+    // Buckets cross midnight
+    let profile = actor.matrix_profile(&request, 4, 30).unwrap();
+    assert_eq!(
+        (profile.sources, profile.targets, profile.buckets),
+        (2, 2, 4)
+    );
+    assert_eq!(profile.times.len(), 16);
+    for bucket in 0..4 {
+        assert!(profile.time(0, 1, bucket).unwrap() > 60.0);
+        assert!(profile.time(1, 0, bucket).unwrap() > 60.0);
+    }
+
+    // The first bucket is a regular matrix request at the same departure time
+    let request = proto::Options {
+        format: Format::Pbf as i32,
+        ..request
+    };
+    let Ok(Response::Pbf(api)) = actor.matrix(&request) else {
+        panic!("Expected PBF response");
+    };
+    let times = api.matrix.unwrap().times;
+    for (i, &time) in times.iter().enumerate() {
+        let profile_time = profile.profile(i as u32 / 2, i as u32 % 2)[0];
+        assert!(
+            (profile_time - time).abs() < 1.0,
+            "{profile_time} vs {time}"
+        );
+    }
+
+    let no_time = proto::Options {
+        date_time_type: proto::options::DateTimeType::NoTime as i32,
+        ..request
+    };
+    assert!(actor.matrix_profile(&no_time, 4, 30).is_err());
+
+    // Empty and oversized profiles are rejected
+    assert!(actor.matrix_profile(&request, 0, 30).is_err());
+    assert!(actor.matrix_profile(&request, u32::MAX, 1).is_err());
+}
+
+#[test]
+fn matrix_concise_json() {
+    #[derive(miniserde::Deserialize, PartialEq, Debug)]
+    struct Concise {
+        id: Option<String>,
+        sources_to_targets: Rows,
+        units: String,
+        algorithm: String,
+    }
+    #[derive(miniserde::Deserialize, PartialEq, Debug)]
+    struct Rows {
+        durations: Vec<Vec<Option<u32>>>,
+        distances: Vec<Vec<Option<f64>>>,
+    }
+
+    let config = ConfigBuilder {
+        mjolnir: valhalla::config::Mjolnir {
+            tile_extract: ANDORRA_TILES.into(),
+            traffic_extract: ANDORRA_TRAFFIC.into(),
+            ..Default::default()
+        },
+        ..Default::default()
+    }
+    .build();
+    let mut actor = Actor::new(&config).unwrap();
+    let locations: Vec<_> = [
+        ANDORRA_TEST_LOC_1,
+        ANDORRA_TEST_LOC_2,
+        LatLon(42.54381401912126, 1.4756460643803673),
+    ]
+    .into_iter()
+    .map(|ll| proto::Location {
+        ll: ll.into(),
+        ..Default::default()
+    })
+    .collect();
+    let request = proto::Options {
+        format: Format::Pbf as i32,
+        costing_type: proto::costing::Type::Auto as i32,
+        sources: locations[..2].to_vec(),
+        targets: locations,
+        ..Default::default()
+    };
+
+    let Ok(Response::Pbf(api)) = actor.matrix(&request) else {
+        panic!("Expected PBF response");
+    };
+    let matrix = api.matrix.unwrap();
+    let response = actor.matrix_concise_json(&request);
+    let Ok(Response::Json(json)) = response else {
+        panic!("Expected JSON response, got: {response:?}");
+    };
+    let concise: Concise = miniserde::json::from_str(&json).expect("Invalid JSON");
+    assert_eq!(concise.units, "kilometers");
+    assert_eq!(concise.sources_to_targets.durations.len(), 2);
+    for s in 0..2 {
+        assert_eq!(concise.sources_to_targets.durations[s].len(), 3);
+        for t in 0..3 {
+            let i = s * 3 + t;
+            let duration = concise.sources_to_targets.durations[s][t].unwrap();
+            let distance = concise.sources_to_targets.distances[s][t].unwrap();
+            assert_eq!(duration, matrix.times[i] as u32);
+            assert!((distance - matrix.distances[i] as f64 / 1000.0).abs() < 1e-3);
+        }
+    }
+
+    // Same output as Valhalla's own serializer for `verbose: false` requests
+    let json_request = proto::Options {
+        format: Format::Json as i32,
+        has_id: Some(proto::options::HasId::Id("concise \"matrix\"".into())),
+        has_verbose: Some(proto::options::HasVerbose::Verbose(false)),
+        ..request.clone()
+    };
+    let Ok(Response::Json(expected)) = actor.matrix(&json_request) else {
+        panic!("Expected JSON response");
+    };
+    let Ok(Response::Json(written)) = actor.matrix_concise_json(&json_request) else {
+        panic!("Expected JSON response");
+    };
+    let expected: Concise = miniserde::json::from_str(&expected).expect("Invalid JSON");
+    let written: Concise = miniserde::json::from_str(&written).expect("Invalid JSON");
+    assert_eq!(written.id.as_deref(), Some("concise \"matrix\""));
+    assert_eq!(written, expected);
+
+    // The second response is written into the recycled buffer of the first one, so leftovers would show up here
+    let Ok(Response::Json(second)) = actor.matrix_concise_json(&request) else {
+        panic!("Expected JSON response");
+    };
+    assert_eq!(second, json);
+}
+
+#[test]
+fn trace_session() {
+    let config = ConfigBuilder {
+        mjolnir: valhalla::config::Mjolnir {
+            tile_extract: ANDORRA_TILES.into(),
+            traffic_extract: ANDORRA_TRAFFIC.into(),
+            ..Default::default()
+        },
+        ..Default::default()
+    }
+    .build();
+    let actor = Actor::new(&config).unwrap();
+
+    // "qwnapA__c|A_CeOu@qEyAkMs@cISuFEePS_Ze@yG_A}EwNyc@iG_P_BoE" from the `request_response_format` test
+    let trace = [
+        LatLon(42.508169, 1.52576),
+        LatLon(42.508233, 1.526019),
+        LatLon(42.50826, 1.526124),
+        LatLon(42.508305, 1.526354),
+        LatLon(42.508331, 1.526516),
+        LatLon(42.508341, 1.526639),
+        LatLon(42.508344, 1.526914),
+        LatLon(42.508354, 1.527346),
+        LatLon(42.508373, 1.527487),
+        LatLon(42.508405, 1.527598),
+        LatLon(42.508657, 1.528187),
+        LatLon(42.50879, 1.528459),
+        LatLon(42.508838, 1.528563),
+    ];
+    let request = proto::Options {
+        costing_type: proto::costing::Type::Auto as i32,
+        ..Default::default()
+    };
+
+    let lookahead = 3;
+    let mut session = actor.trace_session(&request, lookahead).unwrap();
+    let mut matched = vec![];
+    for (i, &point) in trace.iter().enumerate() {
+        let finalized = session.push(point, i as f64).unwrap();
+        // Only points that are far enough from the head of the trace are finalized
+        assert!(matched.len() + finalized.len() <= (i + 1).saturating_sub(lookahead as usize));
+        matched.extend(finalized);
+    }
+    matched.extend(session.finish().unwrap());
+    assert!(session.finish().unwrap().is_empty());
+
+    assert_eq!(matched.len(), trace.len());
+    for (i, point) in matched.iter().enumerate() {
+        assert_eq!(point.point_index, i as u32);
+        assert_ne!(
+            point.edge,
+            valhalla::GraphId::default(),
+            "Point {i} isn't matched"
+        );
+        assert!((0.0..=1.0).contains(&point.percent_along));
+        assert!(point.distance < 50.0, "Point {i} is too far from the road");
+    }
+}
+
+#[test]
+fn trace_match() {
+    let config = ConfigBuilder {
+        mjolnir: valhalla::config::Mjolnir {
+            tile_extract: ANDORRA_TILES.into(),
+            traffic_extract: ANDORRA_TRAFFIC.into(),
+            ..Default::default()
+        },
+        ..Default::default()
+    }
+    .build();
+    let mut actor = Actor::new(&config).unwrap();
+
+    let request = proto::Options {
+        costing_type: proto::costing::Type::Auto as i32,
+        has_encoded_polyline: Some(proto::options::HasEncodedPolyline::EncodedPolyline(
+            "qwnapA__c|A_CeOu@qEyAkMs@cISuFEePS_Ze@yG_A}EwNyc@iG_P_BoE".into(),
+        )),
+        ..Default::default()
+    };
+    let trace_match = actor.trace_match(&request).unwrap();
+
+    assert_eq!(trace_match.points.len(), 13);
+    assert!(!trace_match.edges.is_empty());
+    for (i, point) in trace_match.points.iter().enumerate() {
+        assert_eq!(point.point_index, i as u32);
+        assert!(
+            trace_match.edges.contains(&point.edge),
+            "Point {i} is matched to an edge outside of the matched path"
+        );
+        assert!((0.0..=1.0).contains(&point.percent_along));
+    }
+    for pair in trace_match.edges.windows(2) {
+        assert_ne!(pair[0], pair[1], "Consecutive edges should be deduplicated");
+    }
+
+    // Trace without points can't be matched
+    let request = proto::Options {
+        costing_type: proto::costing::Type::Auto as i32,
+        ..Default::default()
+    };
+    assert!(actor.trace_match(&request).is_err());
+
+    // Edge walking is not supported, and the failed request doesn't affect the next one
+    let request = proto::Options {
+        costing_type: proto::costing::Type::Auto as i32,
+        shape_match: proto::ShapeMatch::EdgeWalk as i32,
+        has_encoded_polyline: Some(proto::options::HasEncodedPolyline::EncodedPolyline(
+            "qwnapA__c|A_CeOu@qEyAkMs@cISuFEePS_Ze@yG_A}EwNyc@iG_P_BoE".into(),
+        )),
+        ..Default::default()
+    };
+    assert!(actor.trace_match(&request).is_err());
+    let request = proto::Options {
+        shape_match: proto::ShapeMatch::MapSnap as i32,
+        ..request
+    };
+    let map_snap = actor.trace_match(&request).unwrap();
+    assert_eq!(map_snap.edges, trace_match.edges);
+    assert_eq!(map_snap.points.len(), trace_match.points.len());
+}
+
+#[test]
+fn actor_stats() {
+    let config = ConfigBuilder {
+        mjolnir: valhalla::config::Mjolnir {
+            tile_extract: ANDORRA_TILES.into(),
+            traffic_extract: ANDORRA_TRAFFIC.into(),
+            ..Default::default()
+        },
+        ..Default::default()
+    }
+    .build();
+    let mut actor = Actor::new(&config).unwrap();
+    assert!(actor.stats().actions.is_empty());
+
+    let request = proto::Options {
+        costing_type: proto::costing::Type::Auto as i32,
+        locations: vec![
+            proto::Location {
+                ll: ANDORRA_TEST_LOC_1.into(),
+                ..Default::default()
+            },
+            proto::Location {
+                ll: ANDORRA_TEST_LOC_2.into(),
+                ..Default::default()
+            },
+        ],
+        ..Default::default()
+    };
+    actor.route(&request).unwrap();
+    actor.route(&request).unwrap();
+    // No locations to correlate
+    assert!(actor.locate(&proto::Options::default()).is_err());
+
+    let stats = actor.stats();
+    assert_eq!(stats.actions.len(), 2);
+    let route = stats
+        .actions
+        .iter()
+        .find(|a| a.action() == Some(proto::options::Action::Route))
+        .unwrap();
+    assert_eq!((route.requests, route.errors), (2, 0));
+    assert!(route.total_latency_ms > 0.0 && route.max_latency_ms <= route.total_latency_ms);
+    assert!(route.mean_latency_ms() <= route.max_latency_ms);
+    let locate = stats
+        .actions
+        .iter()
+        .find(|a| a.action() == Some(proto::options::Action::Locate))
+        .unwrap();
+    assert_eq!((locate.requests, locate.errors), (1, 1));
+
+    let Ok(Response::Json(status)) = actor.status(&proto::Options::default()) else {
+        panic!("Expected JSON status");
+    };
+    assert!(
+        status.contains(r#""counters":{"actions":{"route":{"requests":2,"errors":0,"#),
+        "{status}"
+    );
+    assert!(status.contains(r#""resident_memory":"#), "{status}");
+    assert!(status.contains(r#""traffic":{"tiles":"#), "{status}");
+
+    // Actor's own endpoints don't mix with the regular requests of their actions
+    let trace = proto::Options {
+        costing_type: proto::costing::Type::Auto as i32,
+        has_encoded_polyline: Some(proto::options::HasEncodedPolyline::EncodedPolyline(
+            "qwnapA__c|A_CeOu@qEyAkMs@cISuFEePS_Ze@yG_A}EwNyc@iG_P_BoE".into(),
+        )),
+        ..Default::default()
+    };
+    actor.trace_match(&trace).unwrap();
+    let stats = actor.stats();
+    let trace_match = stats
+        .actions
+        .iter()
+        .find(|a| a.endpoint == ActorEndpoint::TraceMatch)
+        .unwrap();
+    assert_eq!(
+        trace_match.action(),
+        Some(proto::options::Action::TraceAttributes)
+    );
+    assert_eq!((trace_match.requests, trace_match.errors), (1, 0));
+    let trace_attributes = stats
+        .actions
+        .iter()
+        .filter(|a| a.action() == Some(proto::options::Action::TraceAttributes));
+    assert_eq!(trace_attributes.count(), 1);
+
+    assert!(stats.traffic.tiles > 0);
+    assert!(stats.traffic.updated_tiles <= stats.traffic.tiles);
+    assert!(stats.traffic.min_age_secs <= stats.traffic.max_age_secs);
+    let Ok(Response::Json(status)) = actor.status(&proto::Options::default()) else {
+        panic!("Expected JSON status");
+    };
+    assert!(
+        status.contains(r#""trace_match":{"requests":1,"#),
+        "{status}"
+    );
 }
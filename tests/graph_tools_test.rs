@@ -0,0 +1,307 @@
+use std::collections::HashSet;
+
+use valhalla::{
+    ConfigBuilder, GraphId, GraphReader,
+    graph_tools::{self, ValidationErrorKind},
+};
+
+fn andorra_reader() -> GraphReader {
+    let config = ConfigBuilder {
+        mjolnir: valhalla::config::Mjolnir {
+            tile_extract: "tests/andorra/tiles.tar".into(),
+            traffic_extract: "tests/andorra/traffic.tar".into(),
+            ..Default::default()
+        },
+        ..Default::default()
+    }
+    .build();
+    GraphReader::new(&config).expect("Failed to create GraphReader")
+}
+
+#[test]
+fn validate() {
+    let reader = andorra_reader();
+
+    let errors = graph_tools::validate(&reader, 100);
+    assert!(
+        errors.is_empty(),
+        "Unexpected errors: {:#?}",
+        errors.iter().map(ToString::to_string).collect::<Vec<_>>()
+    );
+
+    // Validation stops right away with zero limit
+    assert!(graph_tools::validate(&reader, 0).is_empty());
+
+    // A single local tile lacks both its neighbours and the tiles of other hierarchy levels
+    let tile = *reader
+        .tiles()
+        .iter()
+        .find(|tile| tile.level() == 2)
+        .expect("No local tiles");
+    let errors = graph_tools::validate(&reader.subset(&[tile]), usize::MAX);
+    let kinds: HashSet<_> = errors.iter().map(|error| error.kind).collect();
+    assert_eq!(
+        kinds,
+        HashSet::from([
+            ValidationErrorKind::MissingEndNode,
+            ValidationErrorKind::MissingTransitionNode
+        ]),
+        "Unexpected errors: {:#?}",
+        errors.iter().map(ToString::to_string).collect::<Vec<_>>()
+    );
+    assert!(errors.iter().all(|error| error.tile == tile));
+    assert_eq!(graph_tools::validate(&reader.subset(&[tile]), 1).len(), 1);
+}
+
+#[cfg(feature = "proto")]
+#[test]
+fn connected_components() {
+    use valhalla::{CostingModel, graph_tools::ConnectedComponents, proto};
+
+    let reader = andorra_reader();
+    let auto = CostingModel::new(proto::costing::Type::Auto).unwrap();
+    let components = ConnectedComponents::new(&reader, &auto).expect("Failed to label components");
+    assert!(!components.is_empty());
+
+    // The largest component covers most of the drivable network
+    let sizes: Vec<_> = (0..components.len() as u32)
+        .map(|c| components.component_size(c))
+        .collect();
+    let largest = sizes.iter().copied().max().unwrap();
+    assert!(largest as usize * 2 > sizes.iter().map(|&s| s as usize).sum::<usize>());
+
+    let mut labelled = 0;
+    for tile_id in reader.tiles() {
+        let tile = reader.graph_tile(tile_id).unwrap();
+        for (index, de) in tile.directededges().iter().enumerate() {
+            let edge =
+                GraphId::from_parts(tile_id.level(), tile_id.tileid(), index as u32).unwrap();
+            match components.component(edge) {
+                Some(component) => {
+                    assert!(auto.edge_accessible(de) && !de.is_shortcut());
+                    assert_eq!(
+                        components.edge_component_size(edge),
+                        sizes[component as usize]
+                    );
+                    labelled += 1;
+                }
+                None => assert_eq!(components.edge_component_size(edge), 0),
+            }
+        }
+    }
+    assert!(labelled > 0);
+    assert_eq!(components.component(GraphId::default()), None);
+
+    let file = tempfile::NamedTempFile::new().unwrap();
+    components
+        .save(file.path())
+        .expect("Failed to save components");
+    let loaded =
+        ConnectedComponents::load(&reader, file.path()).expect("Failed to load components");
+    assert_eq!(loaded.len(), components.len());
+    for tile_id in reader.tiles() {
+        let tile = reader.graph_tile(tile_id).unwrap();
+        for index in 0..tile.directededges().len() as u32 {
+            let edge = GraphId::from_parts(tile_id.level(), tile_id.tileid(), index).unwrap();
+            assert_eq!(loaded.component(edge), components.component(edge));
+        }
+    }
+
+    // A component count that wraps the expected file size around is rejected
+    let mut corrupted = std::fs::read(file.path()).unwrap();
+    let components_count = u64::from_le_bytes(corrupted[32..40].try_into().unwrap());
+    corrupted[32..40].copy_from_slice(&(components_count + (1 << 62)).to_le_bytes());
+    std::fs::write(file.path(), &corrupted).unwrap();
+    assert!(ConnectedComponents::load(&reader, file.path()).is_err());
+
+    assert!(ConnectedComponents::load(&reader, "missing.bin").is_err());
+}
+
+#[test]
+fn partition() {
+    let reader = andorra_reader();
+    assert!(graph_tools::partition(&reader, 0, 0.1).is_err());
+    // There can't be more non-empty partitions than tiles
+    let tile_count = reader.tiles().len() as u32;
+    assert!(graph_tools::partition(&reader, tile_count + 1, 0.1).is_err());
+    let partitioning =
+        graph_tools::partition(&reader, tile_count, 0.1).expect("Failed to partition");
+    // Even with skewed tile weights, every partition gets at least one tile
+    for partition in 0..tile_count {
+        assert!(!partitioning.tiles_in(partition).is_empty());
+    }
+
+    let partitioning = graph_tools::partition(&reader, 2, 0.5).expect("Failed to partition");
+    assert_eq!(partitioning.tiles.len(), reader.tiles().len());
+    assert_eq!(partitioning.partitions.len(), partitioning.tiles.len());
+
+    let shards = [partitioning.tiles_in(0), partitioning.tiles_in(1)];
+    assert!(shards.iter().all(|tiles| !tiles.is_empty()));
+    assert_eq!(shards[0].len() + shards[1].len(), partitioning.tiles.len());
+
+    for boundary in &partitioning.boundary_edges {
+        assert_ne!(boundary.partition, boundary.target_partition);
+        assert_eq!(
+            partitioning.partition_of(boundary.edge),
+            Some(boundary.partition)
+        );
+        let tile = reader.graph_tile(boundary.edge).unwrap();
+        let de = tile.directededge(boundary.edge.id()).unwrap();
+        assert_eq!(
+            partitioning.partition_of(de.endnode()),
+            Some(boundary.target_partition)
+        );
+    }
+
+    // Transitions between hierarchy levels may cross partitions too, and all of them are reported
+    let mut crossing_transitions = 0;
+    for tile_id in reader.tiles() {
+        let tile = reader.graph_tile(tile_id).unwrap();
+        for node in tile.nodes() {
+            for transition in tile.node_transitions(node) {
+                if partitioning.partition_of(transition.endnode())
+                    != partitioning.partition_of(tile_id)
+                {
+                    crossing_transitions += 1;
+                }
+            }
+        }
+    }
+    assert_eq!(
+        partitioning.boundary_transitions.len(),
+        crossing_transitions
+    );
+    for boundary in &partitioning.boundary_transitions {
+        assert_ne!(boundary.partition, boundary.target_partition);
+        assert_eq!(
+            partitioning.partition_of(boundary.node),
+            Some(boundary.partition)
+        );
+        assert_eq!(
+            partitioning.partition_of(boundary.end_node),
+            Some(boundary.target_partition)
+        );
+        let tile = reader.graph_tile(boundary.node).unwrap();
+        let node = tile.node(boundary.node.id()).unwrap();
+        assert!(
+            tile.node_transitions(node)
+                .iter()
+                .any(|transition| transition.endnode() == boundary.end_node)
+        );
+    }
+
+    // Each shard sees only its own tiles
+    let shard = reader.subset(&shards[0]);
+    assert_eq!(shard.tiles().len(), shards[0].len());
+    for tile_id in &shards[0] {
+        assert!(shard.graph_tile(*tile_id).is_some());
+    }
+    for tile_id in &shards[1] {
+        assert!(shard.graph_tile(*tile_id).is_none());
+    }
+}
+
+#[cfg(feature = "proto")]
+#[test]
+fn time_raster() {
+    use valhalla::{CostingModel, EdgeIndex, LatLon, proto};
+
+    let reader = andorra_reader();
+    let index = EdgeIndex::new(&reader).unwrap();
+    let auto = CostingModel::new(proto::costing::Type::Auto).unwrap();
+    let sant_julia = LatLon(42.50107335756198, 1.510341967860551);
+    let andorra_la_vella = LatLon(42.50627089323736, 1.521734167223563);
+
+    let single = graph_tools::time_raster(&index, &auto, &[sant_julia], 100.0, 600.0, 0.002)
+        .expect("Failed to build raster");
+    assert!(single.rows > 0 && single.columns > 0);
+    assert_eq!(single.times.len(), (single.rows * single.columns) as usize);
+    assert!(single.time_at(sant_julia).unwrap() < 60.0);
+    assert!(single.time_at(LatLon(0.0, 0.0)).is_none());
+
+    // With more origins, each cell is reached at least as fast as from a single one
+    let both = graph_tools::time_raster(
+        &index,
+        &auto,
+        &[sant_julia, andorra_la_vella],
+        100.0,
+        600.0,
+        0.002,
+    )
+    .unwrap();
+    assert!(both.time_at(andorra_la_vella).unwrap() < 60.0);
+    for row in 0..single.rows {
+        for column in 0..single.columns {
+            let center = single.cell_center(row, column);
+            if let Some(time) = single.time_at(center) {
+                assert!(both.time_at(center).unwrap() <= time + 1e-3);
+            }
+        }
+    }
+
+    // Merging per-worker rasters is deterministic
+    let again = graph_tools::time_raster(
+        &index,
+        &auto,
+        &[sant_julia, andorra_la_vella],
+        100.0,
+        600.0,
+        0.002,
+    )
+    .unwrap();
+    assert_eq!(again.times, both.times);
+
+    assert!(graph_tools::time_raster(&index, &auto, &[sant_julia], 100.0, 0.0, 0.002).is_err());
+}
+
+#[cfg(feature = "proto")]
+#[test]
+fn arrive_by() {
+    use valhalla::{CostingModel, EdgeIndex, LatLon, proto};
+
+    let reader = andorra_reader();
+    let index = EdgeIndex::new(&reader).unwrap();
+    let auto = CostingModel::new(proto::costing::Type::Auto).unwrap();
+    let sant_julia = LatLon(42.50107335756198, 1.510341967860551);
+    let andorra_la_vella = LatLon(42.50627089323736, 1.521734167223563);
+    let monday_9am = 24 * 3600 + 9 * 3600;
+
+    let targets = [sant_julia, andorra_la_vella];
+    let rasters =
+        graph_tools::arrive_by_rasters(&index, &auto, &targets, monday_9am, 100.0, 900.0, 0.002)
+            .expect("Failed to build rasters");
+    assert_eq!(rasters.len(), 2);
+    for (raster, &target) in rasters.iter().zip(&targets) {
+        assert!(raster.time_at(target).unwrap() < 60.0);
+    }
+
+    let table = graph_tools::arrive_by_table(
+        &index,
+        &auto,
+        &[andorra_la_vella, sant_julia],
+        &targets,
+        monday_9am,
+        100.0,
+        900.0,
+    )
+    .expect("Failed to build table");
+    assert_eq!(table.len(), 4);
+    // From Andorra la Vella to Sant Julia and back, both a few minutes away
+    assert!(table[0] > 60.0 && table[0] < 900.0, "{table:?}");
+    assert!(table[3] > 60.0 && table[3] < 900.0, "{table:?}");
+    // Each source is at one of the targets, which is reached directly along the snapped edge
+    assert!(table[1] < 1.0 && table[2] < 1.0, "{table:?}");
+
+    // Table agrees with the raster of the same target
+    let raster_time = rasters[0].time_at(andorra_la_vella).unwrap();
+    assert!(
+        (raster_time - table[0]).abs() < 120.0,
+        "{raster_time} vs {}",
+        table[0]
+    );
+
+    assert!(
+        graph_tools::arrive_by_table(&index, &auto, &[], &targets, 7 * 24 * 3600, 100.0, 900.0)
+            .is_err()
+    );
+}
@@ -0,0 +1,16 @@
+use valhalla::logging::{self, Level};
+
+// Separate test binary, as Valhalla's global logger is created once per process
+#[test]
+fn ring_logger_after_default_logger() {
+    // The first message creates Valhalla's default logger, which can't be replaced afterwards
+    logging::log(Level::Info, "default logger");
+    assert!(logging::install(8, 0).is_err());
+
+    logging::log(Level::Warn, "not in the ring");
+    assert_eq!(
+        logging::drain(|_, _| panic!("Ring logger is not installed")),
+        0
+    );
+    assert_eq!(logging::counters(), Default::default());
+}
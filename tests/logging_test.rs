@@ -0,0 +1,29 @@
+use valhalla::logging::{self, Level};
+
+// Valhalla has a single global logger, so everything is checked in a single test
+#[test]
+fn ring_logger() {
+    assert_eq!(logging::drain(|_, _| panic!("Nothing is logged yet")), 0);
+
+    logging::install(8, 0).unwrap();
+    assert!(logging::install(8, 0).is_err());
+
+    logging::log(Level::Warn, "first");
+    logging::log(Level::Error, &"x".repeat(1000));
+    let mut messages = Vec::new();
+    let drained = logging::drain(|level, message| messages.push((level, message.to_owned())));
+    assert_eq!(drained, 2);
+    assert_eq!(messages[0], (Level::Warn, "first".to_owned()));
+    assert_eq!(messages[1].0, Level::Error);
+    assert_eq!(messages[1].1.len(), 500);
+    assert_eq!(logging::counters(), Default::default());
+
+    for i in 0..20 {
+        logging::log(Level::Warn, &i.to_string());
+    }
+    let mut messages = Vec::new();
+    logging::drain(|_, message| messages.push(message.to_owned()));
+    assert_eq!(messages, (0..8).map(|i| i.to_string()).collect::<Vec<_>>());
+    assert_eq!(logging::counters().dropped_full, 12);
+    assert_eq!(logging::counters().dropped_rate_limited, 0);
+}
@@ -2,7 +2,8 @@ use miniserde::{Serialize, json};
 use pretty_assertions::assert_eq;
 
 use valhalla::{
-    Access, Config, GraphId, GraphLevel, GraphReader, LatLon, LiveTraffic, TimeZoneInfo,
+    Access, Config, EdgeIndex, GraphId, GraphLevel, GraphReader, LatLon, LiveTraffic, TimeZoneInfo,
+    polyline,
 };
 
 #[derive(Serialize)]
@@ -34,6 +35,82 @@ fn dataset_id() {
     assert_eq!(reader.dataset_id(), 12953172102);
 }
 
+#[test]
+fn tile_headers() {
+    let config = ValhallaConfig {
+        mjolnir: MjolnirConfig {
+            tile_extract: ANDORRA_TILES.into(),
+            traffic_extract: ANDORRA_TRAFFIC.into(),
+        },
+    };
+    let reader = GraphReader::new(&Config::from_json(&json::to_string(&config)).unwrap())
+        .expect("Failed to create GraphReader");
+
+    let headers = reader.tile_headers();
+    assert_eq!(headers.len(), reader.tiles().len());
+    assert!(
+        headers
+            .windows(2)
+            .all(|w| w[0].graph_id.value < w[1].graph_id.value)
+    );
+    for header in &headers {
+        assert_eq!(header.dataset_id, 12953172102);
+        assert!(!header.version.is_empty());
+        assert!(header.has_traffic);
+        assert!(header.edge_info_size > 0 && header.edge_info_size < header.tile_size);
+
+        let tile = reader.graph_tile(header.graph_id).unwrap();
+        assert_eq!(header.node_count as usize, tile.nodes().len());
+        assert_eq!(
+            header.directed_edge_count as usize,
+            tile.directededges().len()
+        );
+
+        let single = reader.tile_header(header.graph_id).unwrap();
+        assert_eq!(single.graph_id, header.graph_id);
+    }
+
+    assert!(reader.tile_header(GraphId::default()).is_none());
+}
+
+#[test]
+fn inventory() {
+    let config = ValhallaConfig {
+        mjolnir: MjolnirConfig {
+            tile_extract: ANDORRA_TILES.into(),
+            traffic_extract: ANDORRA_TRAFFIC.into(),
+        },
+    };
+    let reader = GraphReader::new(&Config::from_json(&json::to_string(&config)).unwrap())
+        .expect("Failed to create GraphReader");
+
+    let inventory = reader.inventory();
+    assert_eq!(inventory.levels.len(), 3); // Highway, Arterial and Local levels
+
+    let mut tiles = 0;
+    for (level, stats) in inventory.levels.iter().enumerate() {
+        let mut nodes = 0;
+        let mut edges = 0;
+        for tile_id in reader.tiles() {
+            if tile_id.level() as usize == level {
+                let tile = reader.graph_tile(tile_id).unwrap();
+                nodes += tile.nodes().len() as u64;
+                edges += tile.directededges().len() as u64;
+            }
+        }
+        assert_eq!(stats.nodes, nodes);
+        assert_eq!(stats.directed_edges, edges);
+        assert_eq!(stats.traffic_tiles, stats.tiles);
+        assert_eq!(stats.traffic_coverage(), 1.0);
+        tiles += stats.tiles;
+    }
+
+    let total = inventory.total();
+    assert_eq!(total.tiles, tiles);
+    assert_eq!(total.tiles as usize, reader.tiles().len());
+    assert!(total.shape_bytes > 0 && total.shape_bytes < total.tile_bytes);
+}
+
 #[test]
 fn graph_tile_can_outlive_reader() {
     let config = ValhallaConfig {
@@ -324,6 +401,47 @@ fn nodes_in_tile() {
     assert_eq!(no_auto_access_count, 22); // all nodes should have auto access
 }
 
+#[test]
+fn node_latlons() {
+    let config = ValhallaConfig {
+        mjolnir: MjolnirConfig {
+            tile_extract: ANDORRA_TILES.into(),
+            traffic_extract: ANDORRA_TRAFFIC.into(),
+        },
+    };
+    let reader = GraphReader::new(&Config::from_json(&json::to_string(&config)).unwrap())
+        .expect("Failed to create GraphReader");
+
+    let mut buffer = Vec::new();
+    for tile_id in reader.tiles() {
+        let tile = reader.graph_tile(tile_id).unwrap();
+        let latlons = tile.node_latlons();
+        assert_eq!(latlons.len(), tile.nodes().len());
+        for (node, ll) in tile.nodes().iter().zip(&latlons) {
+            assert_eq!(tile.node_latlon(node), *ll);
+        }
+
+        buffer.resize(latlons.len(), LatLon::default());
+        tile.node_latlons_into(&mut buffer);
+        assert_eq!(buffer, latlons);
+    }
+}
+
+#[test]
+#[should_panic]
+fn node_latlons_wrong_size() {
+    let config = ValhallaConfig {
+        mjolnir: MjolnirConfig {
+            tile_extract: ANDORRA_TILES.into(),
+            traffic_extract: ANDORRA_TRAFFIC.into(),
+        },
+    };
+    let reader = GraphReader::new(&Config::from_json(&json::to_string(&config)).unwrap())
+        .expect("Failed to create GraphReader");
+    let tile = reader.graph_tile(reader.tiles()[0]).unwrap();
+    tile.node_latlons_into(&mut [LatLon::default(); 1]);
+}
+
 #[test]
 fn reverse_edge() {
     let config = ValhallaConfig {
@@ -348,6 +466,14 @@ fn reverse_edge() {
         let opp_de = &tile.node_edges(end_node)[de.opp_index() as usize];
         assert_eq!(tile.edgeinfo(de).way_id, tile.edgeinfo(opp_de).way_id);
 
+        // Shapes of opposing edges are the same, just in the opposite direction
+        let shape = polyline::decode(&tile.edgeinfo(de).shape, polyline::PRECISION6).unwrap();
+        let mut opp_shape =
+            polyline::decode(&tile.edgeinfo(opp_de).shape, polyline::PRECISION6).unwrap();
+        opp_shape.reverse();
+        assert!(shape.len() >= 2);
+        assert_eq!(shape, opp_shape);
+
         let begin_node = tile.node(opp_de.endnode().id()).unwrap();
         assert_eq!(
             de_index,
@@ -356,6 +482,126 @@ fn reverse_edge() {
     }
 }
 
+#[test]
+fn edge_index() {
+    let config = ValhallaConfig {
+        mjolnir: MjolnirConfig {
+            tile_extract: ANDORRA_TILES.into(),
+            traffic_extract: ANDORRA_TRAFFIC.into(),
+        },
+    };
+    let reader = GraphReader::new(&Config::from_json(&json::to_string(&config)).unwrap())
+        .expect("Failed to create GraphReader");
+    let index = EdgeIndex::new(&reader).expect("Failed to build EdgeIndex");
+    assert!(!index.is_empty());
+
+    // Andorra la Vella
+    let point = LatLon(42.50735, 1.52131);
+    let candidates = index.nearest(point, 100.0, 5);
+    assert!(!candidates.is_empty());
+    assert!(candidates.len() <= 10);
+    assert!(
+        candidates
+            .windows(2)
+            .all(|w| w[0].distance <= w[1].distance)
+    );
+    for candidate in &candidates {
+        assert!(candidate.distance <= 100.0);
+        assert!((0.0..=1.0).contains(&candidate.percent_along));
+        let tile = reader
+            .graph_tile(candidate.edge)
+            .expect("Tile should exist");
+        let de = tile
+            .directededge(candidate.edge.id())
+            .expect("Edge should exist");
+        assert!(!de.is_shortcut());
+    }
+
+    // Opposing edges are returned next to each other with mirrored positions along the edge
+    for pair in candidates.windows(2) {
+        if pair[0].distance == pair[1].distance && pair[0].lat == pair[1].lat {
+            assert!((pair[0].percent_along + pair[1].percent_along - 1.0).abs() < 1e-5);
+        }
+    }
+
+    // Shared between threads without copying
+    std::thread::scope(|s| {
+        for _ in 0..4 {
+            let index = index.clone();
+            s.spawn(move || assert_eq!(index.nearest(point, 100.0, 5).len(), candidates.len()));
+        }
+    });
+
+    // Nothing in the middle of the ocean
+    assert!(index.nearest(LatLon(0.0, 0.0), 1000.0, 5).is_empty());
+}
+
+#[test]
+fn edge_index_decoded_shapes() {
+    let config = ValhallaConfig {
+        mjolnir: MjolnirConfig {
+            tile_extract: ANDORRA_TILES.into(),
+            traffic_extract: ANDORRA_TRAFFIC.into(),
+        },
+    };
+    let reader = GraphReader::new(&Config::from_json(&json::to_string(&config)).unwrap())
+        .expect("Failed to create GraphReader");
+    let index = EdgeIndex::new(&reader).unwrap();
+    assert!(!index.has_decoded_shapes());
+    assert!(index.save_shapes("unused.bin").is_err());
+
+    let decoded = EdgeIndex::with_decoded_shapes(&reader, EdgeIndex::DEFAULT_CELL_SIZE).unwrap();
+    assert!(decoded.has_decoded_shapes());
+    assert_eq!(decoded.len(), index.len());
+
+    let path = std::env::temp_dir().join(format!("edge_index_shapes_{}.bin", std::process::id()));
+    decoded.save_shapes(&path).expect("Failed to save shapes");
+    let mapped = EdgeIndex::with_shapes_file(&reader, EdgeIndex::DEFAULT_CELL_SIZE, &path).unwrap();
+    assert!(mapped.has_decoded_shapes());
+
+    // Offsets that point outside of the shapes are rejected even if the file size is consistent
+    let mut corrupted = std::fs::read(&path).unwrap();
+    let header_size = 40;
+    corrupted[header_size + 8..header_size + 16].copy_from_slice(&u64::MAX.to_le_bytes());
+    std::fs::write(&path, &corrupted).unwrap();
+    assert!(EdgeIndex::with_shapes_file(&reader, EdgeIndex::DEFAULT_CELL_SIZE, &path).is_err());
+    std::fs::remove_file(&path).unwrap();
+
+    for point in [
+        LatLon(42.50735, 1.52131),
+        LatLon(42.54381, 1.51237),
+        LatLon(42.46376, 1.49086),
+    ] {
+        let expected = index.nearest(point, 200.0, 10);
+        for candidates in [
+            decoded.nearest(point, 200.0, 10),
+            mapped.nearest(point, 200.0, 10),
+        ] {
+            assert_eq!(candidates.len(), expected.len());
+            for (a, b) in candidates.iter().zip(&expected) {
+                // Decoded shapes are stored in single precision
+                assert!((a.distance - b.distance).abs() < 0.5);
+                assert!((a.percent_along - b.percent_along).abs() < 1e-3);
+            }
+        }
+
+        // Without the limit, all paths find exactly the same edges within the radius
+        let edges = |index: &EdgeIndex| {
+            let mut edges: Vec<_> = index
+                .nearest(point, 200.0, 1000)
+                .iter()
+                .map(|c| c.edge)
+                .collect();
+            edges.sort_by_key(|edge| (edge.level(), edge.tileid(), edge.id()));
+            edges
+        };
+        assert_eq!(edges(&decoded), edges(&index));
+        assert_eq!(edges(&mapped), edges(&index));
+    }
+
+    assert!(EdgeIndex::with_shapes_file(&reader, 0.005, "missing.bin").is_err());
+}
+
 #[test]
 fn live_traffic() {
     // for this test we should work with copy of the traffic tar to avoid modifying the original one